@@ -0,0 +1,53 @@
+#include "airtime.h"
+
+namespace esphome {
+namespace danfoss_eco {
+
+void AirtimeMeter::on_open(uint32_t now) {
+  if (this->connected_) return;
+  this->connected_ = true;
+  this->opened_at_ = now;
+  this->connections_++;
+}
+
+void AirtimeMeter::on_disconnect(uint32_t now, bool dropped) {
+  if (!this->connected_) return;
+  this->connected_ = false;
+  this->connected_ms_ += now - this->opened_at_;
+  if (dropped) this->reconnects_++;
+}
+
+void AirtimeMeter::on_request(uint16_t bytes) {
+  this->operations_++;
+  this->bytes_ += bytes;
+}
+
+void AirtimeMeter::on_response(uint16_t bytes) { this->bytes_ += bytes; }
+
+uint32_t AirtimeMeter::connected_ms(uint32_t now) const {
+  return this->connected_ ? this->connected_ms_ + (now - this->opened_at_) : this->connected_ms_;
+}
+
+float AirtimeMeter::battery_drain(const EnergyModel &model, uint32_t now) const {
+  float charge = this->connected_ms(now) / 1000.0f * model.connected_current +
+                 this->connections_ * model.connection_charge + this->operations_ * model.operation_charge;
+  return charge / 3600.0f;  // mAs to mAh
+}
+
+float AirtimeMeter::value(AirtimeStat stat, const EnergyModel &model, uint32_t now) const {
+  switch (stat) {
+    case AirtimeStat::CONNECTED_TIME:
+      return this->connected_ms(now) / 1000.0f;
+    case AirtimeStat::OPERATIONS:
+      return this->operations_;
+    case AirtimeStat::BYTES:
+      return this->bytes_;
+    case AirtimeStat::RECONNECTS:
+      return this->reconnects_;
+    default:
+      return this->battery_drain(model, now);
+  }
+}
+
+} // namespace danfoss_eco
+} // namespace esphome
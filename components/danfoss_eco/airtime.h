@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstdint>
+
+namespace esphome {
+namespace danfoss_eco {
+
+enum class AirtimeStat : uint8_t {
+  CONNECTED_TIME,  // s the link was open
+  OPERATIONS,      // GATT requests sent
+  BYTES,           // ATT bytes sent and received
+  RECONNECTS,      // links dropped while commands were still queued
+  BATTERY_DRAIN,   // estimated eTRV charge used, mAh
+};
+static const uint8_t AIRTIME_STAT_COUNT = 5;
+
+/**
+ * Rough cost of radio activity on the eTRV side, used to turn airtime into battery drain.
+ */
+struct EnergyModel {
+  float connected_current{0.5f};  // mA drawn while the link is open
+  float connection_charge{5.0f};  // mAs per connection (advertising response, link setup)
+  float operation_charge{0.2f};   // mAs per GATT request, including the decryption on the valve
+};
+
+/**
+ * Airtime totals of one valve since boot, all counters only go up.
+ */
+class AirtimeMeter {
+ public:
+  void on_open(uint32_t now);
+  void on_disconnect(uint32_t now, bool dropped);
+  void on_request(uint16_t bytes);
+  void on_response(uint16_t bytes);
+
+  // Includes the running session
+  uint32_t connected_ms(uint32_t now) const;
+  uint32_t connections() const { return this->connections_; }
+  uint32_t operations() const { return this->operations_; }
+  uint32_t bytes() const { return this->bytes_; }
+  uint32_t reconnects() const { return this->reconnects_; }
+  float battery_drain(const EnergyModel &model, uint32_t now) const;
+  float value(AirtimeStat stat, const EnergyModel &model, uint32_t now) const;
+
+ protected:
+  bool connected_{false};
+  uint32_t opened_at_{0};
+  uint32_t connected_ms_{0};
+  uint32_t connections_{0};
+  uint32_t operations_{0};
+  uint32_t bytes_{0};
+  uint32_t reconnects_{0};
+};
+
+} // namespace danfoss_eco
+} // namespace esphome
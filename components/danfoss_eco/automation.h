@@ -0,0 +1,55 @@
+#pragma once
+
+#include "esphome/core/automation.h"
+#include "my_component.h"
+
+namespace esphome {
+namespace danfoss_eco {
+
+template<typename... Ts> class SetScheduleDayAction : public Action<Ts...> {
+ public:
+  explicit SetScheduleDayAction(MyComponent *parent) : parent_(parent) {}
+
+  void set_day(uint8_t day) { this->day_ = day; }
+  // Times are half hours since midnight, periods which are not set stay disabled
+  void set_period(uint8_t index, uint8_t start, uint8_t end) {
+    if (index >= SCHEDULE_PERIODS) return;
+    this->schedule_.periods[index].start = start;
+    this->schedule_.periods[index].end = end;
+  }
+
+  void play(Ts... x) override { this->parent_->set_schedule_day(this->day_, this->schedule_); }
+
+ protected:
+  MyComponent *parent_;
+  uint8_t day_{0};
+  ScheduleDay schedule_;
+};
+
+template<typename... Ts> class SetTemperatureLimitsAction : public Action<Ts...> {
+ public:
+  explicit SetTemperatureLimitsAction(MyComponent *parent) : parent_(parent) {}
+
+  void set_min(float min) { this->min_ = min; }
+  void set_max(float max) { this->max_ = max; }
+
+  void play(Ts... x) override { this->parent_->set_temperature_limits(this->min_, this->max_); }
+
+ protected:
+  MyComponent *parent_;
+  float min_{5.0f};
+  float max_{28.0f};
+};
+
+template<typename... Ts> class DumpGattTraceAction : public Action<Ts...> {
+ public:
+  explicit DumpGattTraceAction(MyComponent *parent) : parent_(parent) {}
+
+  void play(Ts... x) override { this->parent_->dump_gatt_trace(); }
+
+ protected:
+  MyComponent *parent_;
+};
+
+} // namespace danfoss_eco
+} // namespace esphome
@@ -1,6 +1,8 @@
 import esphome.codegen as cg
 import esphome.config_validation as cv
-from esphome.components import climate, ble_client, sensor, binary_sensor
+from esphome import automation
+from esphome.components import climate, ble_client, sensor, binary_sensor, time
+from esphome.components.danfoss_eco_scanner.sensor import DanfossEcoScanner
 from esphome.const import (
     CONF_ID,
     CONF_TEMPERATURE,
@@ -8,6 +10,7 @@ from esphome.const import (
     CONF_ENTITY_CATEGORY,
     ENTITY_CATEGORY_DIAGNOSTIC,
     STATE_CLASS_MEASUREMENT,
+    STATE_CLASS_TOTAL_INCREASING,
     UNIT_PERCENT,
     UNIT_CELSIUS,
     CONF_DEVICE_CLASS,
@@ -15,6 +18,10 @@ from esphome.const import (
     DEVICE_CLASS_TEMPERATURE,
     DEVICE_CLASS_PROBLEM,
     CONF_UPDATE_INTERVAL,
+    CONF_TIME_ID,
+    DEVICE_CLASS_DURATION,
+    UNIT_MILLISECOND,
+    UNIT_SECOND,
 )
 
 CODEOWNERS = ["@dmitry-cherkas"]
@@ -25,12 +32,198 @@ CONF_PIN_CODE = 'pin_code'
 CONF_SECRET_KEY = 'secret_key'
 CONF_PROBLEMS = 'problems'
 CONF_VISUAL = 'visual'
+CONF_CONNECTION_SLOTS = 'connection_slots'
+CONF_SLOT_WAIT = 'slot_wait'
+CONF_READ_MULTIPLE = 'read_multiple'
+CONF_MIN_UPDATE_INTERVAL = 'min_update_interval'
+CONF_COALESCED_COMMANDS = 'coalesced_commands'
+CONF_LATENCY = 'latency'
+CONF_STALE = 'stale'
+CONF_PUBLISH_HEARTBEAT = 'publish_heartbeat'
+CONF_GATT_TRACE = 'gatt_trace'
+CONF_CONNECTION_PARAMS = 'connection_params'
+CONF_ENABLED = 'enabled'
+CONF_FAST_INTERVAL = 'fast_interval'
+CONF_SLOW_INTERVAL = 'slow_interval'
+CONF_SLOW_LATENCY = 'slow_latency'
+CONF_SUPERVISION_TIMEOUT = 'supervision_timeout'
+CONF_IDLE_DELAY = 'idle_delay'
+CONF_AIRTIME = 'airtime'
+CONF_CONNECTED_TIME = 'connected_time'
+CONF_OPERATIONS = 'operations'
+CONF_BYTES = 'bytes'
+CONF_RECONNECTS = 'reconnects'
+CONF_BATTERY_DRAIN = 'battery_drain'
+CONF_ENERGY_MODEL = 'energy_model'
+CONF_CONNECTED_CURRENT = 'connected_current'
+CONF_CONNECTION_CHARGE = 'connection_charge'
+CONF_OPERATION_CHARGE = 'operation_charge'
+CONF_SKIPPED_DECRYPTS = 'skipped_decrypts'
+CONF_SUPPRESSED_PUBLISHES = 'suppressed_publishes'
+CONF_DAY = 'day'
+CONF_PERIODS = 'periods'
+CONF_START = 'start'
+CONF_END = 'end'
+CONF_MIN_TEMPERATURE = 'min_temperature'
+CONF_MAX_TEMPERATURE = 'max_temperature'
+CONF_TIME_SYNC_THRESHOLD = 'time_sync_threshold'
+CONF_SCANNER_ID = 'scanner_id'
+CONF_SCANNER_MAX_AGE = 'scanner_max_age'
+CONF_SCANNER_MIN_RSSI = 'scanner_min_rssi'
+CONF_P50 = 'p50'
+CONF_P95 = 'p95'
+CONF_MAX = 'max'
 
 eco_ns = cg.esphome_ns.namespace("danfoss_eco")
 DanfossEco = eco_ns.class_(
     "MyComponent", climate.Climate, ble_client.BLEClientNode, cg.Component
 )
 
+LatencyStage = eco_ns.enum("LatencyStage", is_class=True)
+LATENCY_STAGES = {
+    "connect": LatencyStage.CONNECT,
+    "discovery": LatencyStage.DISCOVERY,
+    "queue_wait": LatencyStage.QUEUE_WAIT,
+    "round_trip": LatencyStage.ROUND_TRIP,
+    "write_ack": LatencyStage.WRITE_ACK,
+}
+LatencyStat = eco_ns.enum("LatencyStat", is_class=True)
+LATENCY_STATS = {
+    CONF_P50: LatencyStat.P50,
+    CONF_P95: LatencyStat.P95,
+    CONF_MAX: LatencyStat.MAX,
+}
+
+LATENCY_SENSOR_SCHEMA = sensor.sensor_schema(
+    unit_of_measurement=UNIT_MILLISECOND,
+    accuracy_decimals=0,
+    device_class=DEVICE_CLASS_DURATION,
+    state_class=STATE_CLASS_MEASUREMENT,
+    entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+)
+LATENCY_SCHEMA = cv.Schema(
+    {
+        cv.Optional(stage): cv.Schema(
+            {cv.Optional(stat): LATENCY_SENSOR_SCHEMA for stat in LATENCY_STATS}
+        )
+        for stage in LATENCY_STAGES
+    }
+)
+
+AirtimeStat = eco_ns.enum("AirtimeStat", is_class=True)
+
+
+def airtime_counter_schema(unit=None, accuracy_decimals=0):
+    return sensor.sensor_schema(
+        unit_of_measurement=unit,
+        accuracy_decimals=accuracy_decimals,
+        state_class=STATE_CLASS_TOTAL_INCREASING,
+        entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+    )
+
+
+AIRTIME_STATS = {
+    CONF_CONNECTED_TIME: (AirtimeStat.CONNECTED_TIME, airtime_counter_schema(UNIT_SECOND)),
+    CONF_OPERATIONS: (AirtimeStat.OPERATIONS, airtime_counter_schema()),
+    CONF_BYTES: (AirtimeStat.BYTES, airtime_counter_schema("B")),
+    CONF_RECONNECTS: (AirtimeStat.RECONNECTS, airtime_counter_schema()),
+    CONF_BATTERY_DRAIN: (AirtimeStat.BATTERY_DRAIN, airtime_counter_schema("mAh", 3)),
+}
+AIRTIME_SCHEMA = cv.Schema(
+    {cv.Optional(key): schema for key, (_, schema) in AIRTIME_STATS.items()}
+)
+
+ENERGY_MODEL_SCHEMA = cv.Schema(
+    {
+        cv.Optional(CONF_CONNECTED_CURRENT, default=0.5): cv.positive_float,
+        cv.Optional(CONF_CONNECTION_CHARGE, default=5.0): cv.positive_float,
+        cv.Optional(CONF_OPERATION_CHARGE, default=0.2): cv.positive_float,
+    }
+)
+
+def validate_connection_params(value):
+    # Bluetooth Core spec: the link must survive the longest gap between two heard connection events
+    slow = value[CONF_SLOW_INTERVAL].total_milliseconds
+    timeout = value[CONF_SUPERVISION_TIMEOUT].total_milliseconds
+    if value[CONF_FAST_INTERVAL].total_milliseconds > slow:
+        raise cv.Invalid("fast_interval should not be longer than slow_interval")
+    if timeout <= 2 * (1 + value[CONF_SLOW_LATENCY]) * slow:
+        raise cv.Invalid(
+            "supervision_timeout should be longer than 2 * (1 + slow_latency) * slow_interval"
+        )
+    return value
+
+CONNECTION_INTERVAL = cv.All(
+    cv.positive_time_period_milliseconds,
+    cv.Range(min=cv.TimePeriod(milliseconds=8), max=cv.TimePeriod(milliseconds=4000)),
+)
+
+CONNECTION_PARAMS_SCHEMA = cv.All(
+    cv.Schema(
+        {
+            cv.Optional(CONF_ENABLED, default=True): cv.boolean,
+            cv.Optional(CONF_FAST_INTERVAL, default="15ms"): CONNECTION_INTERVAL,
+            cv.Optional(CONF_SLOW_INTERVAL, default="500ms"): CONNECTION_INTERVAL,
+            cv.Optional(CONF_SLOW_LATENCY, default=4): cv.int_range(min=0, max=499),
+            cv.Optional(CONF_SUPERVISION_TIMEOUT, default="6s"): cv.All(
+                cv.positive_time_period_milliseconds,
+                cv.Range(min=cv.TimePeriod(milliseconds=100), max=cv.TimePeriod(seconds=32)),
+            ),
+            cv.Optional(CONF_IDLE_DELAY, default="1s"): cv.positive_time_period_milliseconds,
+        }
+    ),
+    validate_connection_params,
+)
+
+SetScheduleDayAction = eco_ns.class_("SetScheduleDayAction", automation.Action)
+SetTemperatureLimitsAction = eco_ns.class_("SetTemperatureLimitsAction", automation.Action)
+DumpGattTraceAction = eco_ns.class_("DumpGattTraceAction", automation.Action)
+
+SCHEDULE_DAYS = {
+    "MONDAY": 0,
+    "TUESDAY": 1,
+    "WEDNESDAY": 2,
+    "THURSDAY": 3,
+    "FRIDAY": 4,
+    "SATURDAY": 5,
+    "SUNDAY": 6,
+}
+SCHEDULE_PERIODS = 3
+
+def validate_schedule_time(value):
+    """HH:MM on a half hour, 24:00 is the end of the day. Returns half hours since midnight."""
+    value = cv.string_strict(value)
+    parts = value.split(":")
+    if len(parts) != 2 or not parts[0].isdigit() or not parts[1].isdigit():
+        raise cv.Invalid("Schedule time should be in HH:MM format")
+    hour, minute = int(parts[0]), int(parts[1])
+    if minute not in (0, 30):
+        raise cv.Invalid("Schedule times have a resolution of 30 minutes")
+    half_hours = hour * 2 + minute // 30
+    if half_hours > 48:
+        raise cv.Invalid("Schedule time should be between 00:00 and 24:00")
+    return half_hours
+
+def validate_period(value):
+    if value[CONF_END] < value[CONF_START]:
+        raise cv.Invalid("Period should end after it starts")
+    return value
+
+SCHEDULE_PERIOD_SCHEMA = cv.All(
+    cv.Schema(
+        {
+            cv.Required(CONF_START): validate_schedule_time,
+            cv.Required(CONF_END): validate_schedule_time,
+        }
+    ),
+    validate_period,
+)
+
+def validate_limits(value):
+    if value[CONF_MAX_TEMPERATURE] <= value[CONF_MIN_TEMPERATURE]:
+        raise cv.Invalid("max_temperature should be above min_temperature")
+    return value
+
 def validate_secret(value):
     value = cv.string_strict(value)
     if len(value) != 32:
@@ -69,7 +262,47 @@ CONFIG_SCHEMA = cv.All(
             cv.Optional(CONF_PROBLEMS): binary_sensor.binary_sensor_schema(
                 device_class=DEVICE_CLASS_PROBLEM,
                 entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
-            )
+            ),
+            cv.Optional(CONF_UPDATE_INTERVAL, default="60s"): cv.positive_time_period_milliseconds,
+            cv.Optional(CONF_MIN_UPDATE_INTERVAL, default="60s"): cv.positive_time_period_milliseconds,
+            cv.Optional(CONF_READ_MULTIPLE, default=True): cv.boolean,
+            cv.Optional(CONF_CONNECTION_SLOTS): cv.int_range(min=1, max=9),
+            cv.Optional(CONF_SLOT_WAIT): sensor.sensor_schema(
+                unit_of_measurement=UNIT_MILLISECOND,
+                accuracy_decimals=0,
+                device_class=DEVICE_CLASS_DURATION,
+                state_class=STATE_CLASS_MEASUREMENT,
+                entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+            ),
+            cv.Optional(CONF_COALESCED_COMMANDS): sensor.sensor_schema(
+                accuracy_decimals=0,
+                state_class=STATE_CLASS_TOTAL_INCREASING,
+                entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+            ),
+            cv.Optional(CONF_LATENCY): LATENCY_SCHEMA,
+            cv.Optional(CONF_STALE): binary_sensor.binary_sensor_schema(
+                entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+            ),
+            cv.Optional(CONF_PUBLISH_HEARTBEAT, default="15min"): cv.positive_time_period_milliseconds,
+            cv.Optional(CONF_SKIPPED_DECRYPTS): sensor.sensor_schema(
+                accuracy_decimals=0,
+                state_class=STATE_CLASS_TOTAL_INCREASING,
+                entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+            ),
+            cv.Optional(CONF_SUPPRESSED_PUBLISHES): sensor.sensor_schema(
+                accuracy_decimals=0,
+                state_class=STATE_CLASS_TOTAL_INCREASING,
+                entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+            ),
+            cv.Optional(CONF_AIRTIME): AIRTIME_SCHEMA,
+            cv.Optional(CONF_ENERGY_MODEL, default={}): ENERGY_MODEL_SCHEMA,
+            cv.Optional(CONF_CONNECTION_PARAMS, default={}): CONNECTION_PARAMS_SCHEMA,
+            cv.Optional(CONF_GATT_TRACE): cv.int_range(min=1, max=1024),
+            cv.Optional(CONF_TIME_ID): cv.use_id(time.RealTimeClock),
+            cv.Optional(CONF_TIME_SYNC_THRESHOLD, default="60s"): cv.positive_time_period_milliseconds,
+            cv.Optional(CONF_SCANNER_ID): cv.use_id(DanfossEcoScanner),
+            cv.Optional(CONF_SCANNER_MAX_AGE, default="120s"): cv.positive_time_period_milliseconds,
+            cv.Optional(CONF_SCANNER_MIN_RSSI, default=-90): cv.int_range(min=-127, max=0),
         }
     )
     .extend(cv.COMPONENT_SCHEMA)
@@ -98,3 +331,120 @@ async def to_code(config):
     if CONF_PROBLEMS in config:
         b_sens = await binary_sensor.new_binary_sensor(config[CONF_PROBLEMS])
         cg.add(var.set_problems(b_sens))
+    cg.add(var.set_update_interval(config[CONF_UPDATE_INTERVAL]))
+    cg.add(var.set_min_update_interval(config[CONF_MIN_UPDATE_INTERVAL]))
+    cg.add(var.set_read_multiple(config[CONF_READ_MULTIPLE]))
+    if CONF_CONNECTION_SLOTS in config:
+        cg.add(var.set_connection_slots(config[CONF_CONNECTION_SLOTS]))
+    if CONF_SLOT_WAIT in config:
+        sens = await sensor.new_sensor(config[CONF_SLOT_WAIT])
+        cg.add(var.set_slot_wait(sens))
+    if CONF_COALESCED_COMMANDS in config:
+        sens = await sensor.new_sensor(config[CONF_COALESCED_COMMANDS])
+        cg.add(var.set_coalesced_commands(sens))
+    if CONF_STALE in config:
+        b_sens = await binary_sensor.new_binary_sensor(config[CONF_STALE])
+        cg.add(var.set_stale(b_sens))
+    cg.add(var.set_publish_heartbeat(config[CONF_PUBLISH_HEARTBEAT]))
+    for key, sens_config in config.get(CONF_AIRTIME, {}).items():
+        sens = await sensor.new_sensor(sens_config)
+        cg.add(var.set_airtime_sensor(AIRTIME_STATS[key][0], sens))
+    energy_model = config[CONF_ENERGY_MODEL]
+    cg.add(
+        var.set_energy_model(
+            energy_model[CONF_CONNECTED_CURRENT],
+            energy_model[CONF_CONNECTION_CHARGE],
+            energy_model[CONF_OPERATION_CHARGE],
+        )
+    )
+    conn_params = config[CONF_CONNECTION_PARAMS]
+    cg.add(
+        var.set_connection_params(
+            conn_params[CONF_ENABLED],
+            round(conn_params[CONF_FAST_INTERVAL].total_milliseconds / 1.25),
+            round(conn_params[CONF_SLOW_INTERVAL].total_milliseconds / 1.25),
+            conn_params[CONF_SLOW_LATENCY],
+            round(conn_params[CONF_SUPERVISION_TIMEOUT].total_milliseconds / 10),
+            conn_params[CONF_IDLE_DELAY],
+        )
+    )
+    if CONF_GATT_TRACE in config:
+        cg.add(var.set_gatt_trace(config[CONF_GATT_TRACE]))
+    if CONF_SKIPPED_DECRYPTS in config:
+        sens = await sensor.new_sensor(config[CONF_SKIPPED_DECRYPTS])
+        cg.add(var.set_skipped_decrypts(sens))
+    if CONF_SUPPRESSED_PUBLISHES in config:
+        sens = await sensor.new_sensor(config[CONF_SUPPRESSED_PUBLISHES])
+        cg.add(var.set_suppressed_publishes(sens))
+    for stage, stats in config.get(CONF_LATENCY, {}).items():
+        for stat, sens_config in stats.items():
+            sens = await sensor.new_sensor(sens_config)
+            cg.add(var.set_latency_sensor(LATENCY_STAGES[stage], LATENCY_STATS[stat], sens))
+    if CONF_TIME_ID in config:
+        time_ = await cg.get_variable(config[CONF_TIME_ID])
+        cg.add(var.set_time(time_))
+        cg.add(var.set_time_sync_threshold(config[CONF_TIME_SYNC_THRESHOLD]))
+    if CONF_SCANNER_ID in config:
+        cg.add_define("USE_DANFOSS_ECO_SCANNER")
+        scanner = await cg.get_variable(config[CONF_SCANNER_ID])
+        cg.add(var.set_scanner(scanner))
+        cg.add(var.set_scanner_max_age(config[CONF_SCANNER_MAX_AGE]))
+        cg.add(var.set_scanner_min_rssi(config[CONF_SCANNER_MIN_RSSI]))
+
+
+@automation.register_action(
+    "danfoss_eco.set_schedule_day",
+    SetScheduleDayAction,
+    cv.Schema(
+        {
+            cv.GenerateID(): cv.use_id(DanfossEco),
+            cv.Required(CONF_DAY): cv.enum(SCHEDULE_DAYS, upper=True),
+            cv.Optional(CONF_PERIODS, default=[]): cv.All(
+                cv.ensure_list(SCHEDULE_PERIOD_SCHEMA), cv.Length(max=SCHEDULE_PERIODS)
+            ),
+        }
+    ),
+)
+async def set_schedule_day_to_code(config, action_id, template_arg, args):
+    parent = await cg.get_variable(config[CONF_ID])
+    var = cg.new_Pvariable(action_id, template_arg, parent)
+    cg.add(var.set_day(config[CONF_DAY]))
+    for i, period in enumerate(config[CONF_PERIODS]):
+        cg.add(var.set_period(i, period[CONF_START], period[CONF_END]))
+    return var
+
+
+@automation.register_action(
+    "danfoss_eco.set_temperature_limits",
+    SetTemperatureLimitsAction,
+    cv.All(
+        cv.Schema(
+            {
+                cv.GenerateID(): cv.use_id(DanfossEco),
+                cv.Required(CONF_MIN_TEMPERATURE): cv.All(cv.temperature, cv.float_range(min=5.0, max=35.0)),
+                cv.Required(CONF_MAX_TEMPERATURE): cv.All(cv.temperature, cv.float_range(min=5.0, max=35.0)),
+            }
+        ),
+        validate_limits,
+    ),
+)
+async def set_temperature_limits_to_code(config, action_id, template_arg, args):
+    parent = await cg.get_variable(config[CONF_ID])
+    var = cg.new_Pvariable(action_id, template_arg, parent)
+    cg.add(var.set_min(config[CONF_MIN_TEMPERATURE]))
+    cg.add(var.set_max(config[CONF_MAX_TEMPERATURE]))
+    return var
+
+
+@automation.register_action(
+    "danfoss_eco.dump_gatt_trace",
+    DumpGattTraceAction,
+    cv.Schema(
+        {
+            cv.GenerateID(): cv.use_id(DanfossEco),
+        }
+    ),
+)
+async def dump_gatt_trace_to_code(config, action_id, template_arg, args):
+    parent = await cg.get_variable(config[CONF_ID])
+    return cg.new_Pvariable(action_id, template_arg, parent)
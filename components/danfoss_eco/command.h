@@ -1,41 +1,190 @@
 #pragma once
 
-#include <queue>
 #include "properties.h"
 
 namespace esphome {
 namespace danfoss_eco {
 
-enum class CommandType { READ, WRITE };
+enum class CommandType { READ, READ_MULTIPLE, WRITE };
+enum class CommandState { PENDING, IN_FLIGHT, DONE, FAILED };
+// Interactive commands (user changes) are sent ahead of background ones (polling, housekeeping)
+enum class CommandPriority { INTERACTIVE, BACKGROUND };
 
+// Called once the command is acknowledged by the valve (true), or has run out of retries (false)
+using CommandCallback = void (*)(void *context, bool success);
+
+// How long to wait for ESP_GATTC_READ_CHAR_EVT / ESP_GATTC_WRITE_CHAR_EVT
+static const uint32_t COMMAND_TIMEOUT_MS = 5000;
+static const uint8_t COMMAND_MAX_ATTEMPTS = 3;
+// Retry backoff doubles with every attempt, up to the max
+static const uint32_t COMMAND_RETRY_BACKOFF_MS = 250;
+static const uint32_t COMMAND_RETRY_BACKOFF_MAX_MS = 2000;
+// Max number of properties in a single Read Multiple request
+static const uint8_t COMMAND_MAX_BATCH = 4;
+// Capacity of the per-device command ring
+static const uint8_t COMMAND_QUEUE_SIZE = 16;
+// A background command lets at most this many interactive ones go ahead of it
+static const uint8_t COMMAND_MAX_OVERTAKES = 4;
+
+/**
+ * A single GATT request, stored inline in the CommandRing.
+ * Properties are owned by the Device, commands only refer to them.
+ */
 class Command {
  public:
-  Command(CommandType type, std::shared_ptr<DeviceProperty> property) : type(type), property(property) {}
-  bool execute(ble_client::BLEClient *client) {
-    if (type == CommandType::READ) return property->read_request(client);
-    auto writable = std::static_pointer_cast<WritableProperty>(property);
-    return writable->write_request(client);
+  Command() = default;
+  Command(CommandType type, DeviceProperty *property, CommandCallback callback = nullptr, void *context = nullptr)
+      : type(type),
+        priority(type == CommandType::WRITE ? CommandPriority::INTERACTIVE : CommandPriority::BACKGROUND),
+        property(property),
+        callback(callback),
+        context(context) {}
+
+  // Read needed to act on a user change (e.g. before writing on top of the current value)
+  static Command interactive_read(DeviceProperty *property) {
+    Command cmd(CommandType::READ, property);
+    cmd.priority = CommandPriority::INTERACTIVE;
+    return cmd;
   }
 
- protected:
-  CommandType type;
-  std::shared_ptr<DeviceProperty> property;
+  // Batched read of several properties, answered by a single ESP_GATTC_READ_MULTIPLE_EVT
+  static Command read_multiple(DeviceProperty *const *properties, uint8_t count) {
+    Command cmd(CommandType::READ_MULTIPLE, properties[0]);
+    for (uint8_t i = 0; i < count && i < COMMAND_MAX_BATCH; i++) {
+      cmd.batch[cmd.batch_size++] = properties[i];
+    }
+    return cmd;
+  }
+
+  bool execute(ble_client::BLEClient *client, uint32_t now) {
+    this->attempts++;
+    this->sent_at = now;
+    bool sent;
+    if (type == CommandType::READ) {
+      sent = property->read_request(client);
+    } else if (type == CommandType::READ_MULTIPLE) {
+      sent = DeviceProperty::read_multiple_request(client, this->batch, this->batch_size);
+    } else {
+      sent = static_cast<WritableProperty *>(property)->write_request(client);
+    }
+    if (sent) this->state = CommandState::IN_FLIGHT;
+    return sent;
+  }
+
+  // Schedules another attempt, or fails the command once attempts are exhausted
+  void retry(uint32_t now) {
+    if (this->attempts >= COMMAND_MAX_ATTEMPTS) {
+      this->complete(false);
+      return;
+    }
+    uint32_t backoff = COMMAND_RETRY_BACKOFF_MS << (this->attempts - 1);
+    if (backoff > COMMAND_RETRY_BACKOFF_MAX_MS) backoff = COMMAND_RETRY_BACKOFF_MAX_MS;
+    this->retry_at = now + backoff;
+    this->state = CommandState::PENDING;
+  }
+
+  void complete(bool success) {
+    this->state = success ? CommandState::DONE : CommandState::FAILED;
+    if (this->callback != nullptr) this->callback(this->context, success);
+  }
+
+  bool is_finished() const { return this->state == CommandState::DONE || this->state == CommandState::FAILED; }
+  bool is_response_to(CommandType type, uint16_t handle) const {
+    if (this->state != CommandState::IN_FLIGHT || this->type != type) return false;
+    // Read Multiple responses don't identify a single handle
+    return type == CommandType::READ_MULTIPLE || this->property->handle == handle;
+  }
+  bool reads(const DeviceProperty *prop) const {
+    if (this->type == CommandType::READ) return this->property == prop;
+    for (uint8_t i = 0; this->type == CommandType::READ_MULTIPLE && i < this->batch_size; i++) {
+      if (this->batch[i] == prop) return true;
+    }
+    return false;
+  }
+
+  CommandType type{CommandType::READ};
+  CommandPriority priority{CommandPriority::BACKGROUND};
+  CommandState state{CommandState::PENDING};
+  DeviceProperty *property{nullptr};
+  CommandCallback callback{nullptr};
+  void *context{nullptr};
+  DeviceProperty *batch[COMMAND_MAX_BATCH]{};
+  uint8_t batch_size{0};
+  uint8_t attempts{0};
+  uint8_t overtaken{0};  // interactive commands queued ahead of this one
+  uint32_t queued_at{0};
+  uint32_t sent_at{0};
+  uint32_t retry_at{0};
+  uint32_t timeout_ms{COMMAND_TIMEOUT_MS};
 };
 
-class CommandQueue {
+/**
+ * Fixed-capacity double-ended ring of commands, no heap allocation after construction.
+ * Callers decide what to do when it is full (see Device::enqueue_).
+ */
+template<uint8_t N> class CommandRing {
  public:
-  void push(Command *cmd) { queue_.push(cmd); }
-  Command *pop() {
-    if (queue_.empty()) return nullptr;
-    Command *cmd = queue_.front();
-    queue_.pop();
-    return cmd;
+  bool push_back(const Command &cmd) {
+    if (this->full()) return false;
+    this->items_[(this->head_ + this->size_) % N] = cmd;
+    this->grow_();
+    return true;
+  }
+  bool push_front(const Command &cmd) {
+    if (this->full()) return false;
+    this->head_ = (this->head_ + N - 1) % N;
+    this->items_[this->head_] = cmd;
+    this->grow_();
+    return true;
+  }
+  // Inserts before the i-th command (counted from the front)
+  bool insert(uint8_t i, const Command &cmd) {
+    if (this->full()) return false;
+    this->grow_();
+    for (uint8_t j = this->size_ - 1; j > i; j--) {
+      (*this)[j] = (*this)[j - 1];
+    }
+    (*this)[i] = cmd;
+    return true;
+  }
+  void pop_front() {
+    if (this->empty()) return;
+    this->head_ = (this->head_ + 1) % N;
+    this->size_--;
   }
-  bool empty() const { return queue_.empty(); }
+  // Removes the i-th command (counted from the front), keeping the order of the rest
+  void erase(uint8_t i) {
+    for (; i + 1 < this->size_; i++) {
+      (*this)[i] = (*this)[i + 1];
+    }
+    this->size_--;
+  }
+  void clear() {
+    this->head_ = 0;
+    this->size_ = 0;
+  }
+
+  Command &front() { return this->items_[this->head_]; }
+  Command &operator[](uint8_t i) { return this->items_[(this->head_ + i) % N]; }
+  const Command &operator[](uint8_t i) const { return this->items_[(this->head_ + i) % N]; }
+
+  bool empty() const { return this->size_ == 0; }
+  bool full() const { return this->size_ == N; }
+  uint8_t size() const { return this->size_; }
+  uint8_t capacity() const { return N; }
+  uint8_t high_water_mark() const { return this->high_water_mark_; }
 
  protected:
-  std::queue<Command *> queue_;
+  void grow_() {
+    this->size_++;
+    if (this->size_ > this->high_water_mark_) this->high_water_mark_ = this->size_;
+  }
+
+  Command items_[N];
+  uint8_t head_{0};
+  uint8_t size_{0};
+  uint8_t high_water_mark_{0};
 };
 
 } // namespace danfoss_eco
-} // namespace esphome
\ No newline at end of file
+} // namespace esphome
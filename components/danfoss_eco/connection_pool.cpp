@@ -0,0 +1,69 @@
+#include "connection_pool.h"
+#include "my_component.h"
+#include "esphome/core/hal.h"
+#include "esphome/core/log.h"
+#include <algorithm>
+
+namespace esphome {
+namespace danfoss_eco {
+
+static const char *const TAG = "danfoss_eco.pool";
+
+// Spacing between the first poll of consecutive valves, so they don't all queue up at boot
+static const uint32_t POOL_STAGGER_MS = 5000;
+
+ConnectionPool *ConnectionPool::instance() {
+  static ConnectionPool pool;
+  return &pool;
+}
+
+void ConnectionPool::set_max_slots(uint8_t slots) {
+  if (slots == 0) return;
+  if (this->max_slots_ == 0 || slots < this->max_slots_) {
+    this->max_slots_ = slots;
+  }
+}
+
+uint32_t ConnectionPool::register_component(MyComponent *component) {
+  return POOL_STAGGER_MS * this->registered_++;
+}
+
+void ConnectionPool::request(MyComponent *component) {
+  if (this->holds_slot(component) || this->is_waiting(component)) return;
+  this->waiting_.push_back({component, millis()});
+  this->grant_next();
+}
+
+void ConnectionPool::release(MyComponent *component) {
+  auto it = std::find(this->active_.begin(), this->active_.end(), component);
+  if (it == this->active_.end()) return;
+  this->active_.erase(it);
+  this->grant_next();
+}
+
+bool ConnectionPool::holds_slot(const MyComponent *component) const {
+  return std::find(this->active_.begin(), this->active_.end(), component) != this->active_.end();
+}
+
+bool ConnectionPool::is_waiting(const MyComponent *component) const {
+  for (auto &waiter : this->waiting_) {
+    if (waiter.component == component) return true;
+  }
+  return false;
+}
+
+void ConnectionPool::grant_next() {
+  while (!this->waiting_.empty() && this->active_.size() < this->max_slots_) {
+    Waiter waiter = this->waiting_.front();
+    this->waiting_.pop_front();
+    this->active_.push_back(waiter.component);
+
+    uint32_t wait = millis() - waiter.requested_at;
+    ESP_LOGD(TAG, "Slot granted after %" PRIu32 " ms (%u/%u active, %u waiting)", wait, (unsigned) this->active_.size(),
+             this->max_slots_, (unsigned) this->waiting_.size());
+    waiter.component->on_slot_granted(wait);
+  }
+}
+
+} // namespace danfoss_eco
+} // namespace esphome
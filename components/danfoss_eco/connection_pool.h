@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+namespace esphome {
+namespace danfoss_eco {
+
+class MyComponent; // Forward declaration
+
+/**
+ * Shares a limited number of BLE links between all pooled climate components.
+ *
+ * Components ask for a slot when a poll (or a pending write) is due and are served
+ * first-come-first-served, so with N valves and S slots every valve waits at most
+ * ceil(N / S) sessions for its turn.
+ */
+class ConnectionPool {
+ public:
+  static ConnectionPool *instance();
+
+  // All pooled components share one pool, so the most restrictive setting wins
+  void set_max_slots(uint8_t slots);
+  uint8_t max_slots() const { return this->max_slots_; }
+
+  // Returns the stagger offset for a newly registered component
+  uint32_t register_component(MyComponent *component);
+
+  void request(MyComponent *component);
+  void release(MyComponent *component);
+  bool holds_slot(const MyComponent *component) const;
+  bool is_waiting(const MyComponent *component) const;
+
+  uint8_t active_count() const { return this->active_.size(); }
+  uint8_t waiting_count() const { return this->waiting_.size(); }
+
+ protected:
+  struct Waiter {
+    MyComponent *component;
+    uint32_t requested_at;
+  };
+
+  void grant_next();
+
+  uint8_t max_slots_{0};
+  uint8_t registered_{0};
+  std::vector<MyComponent *> active_;
+  std::deque<Waiter> waiting_;
+};
+
+} // namespace danfoss_eco
+} // namespace esphome
@@ -1,4 +1,6 @@
 #include "device.h"
+#include "esphome/core/hal.h"
+#include "esphome/core/helpers.h"
 #include "esphome/core/log.h"
 #include "helpers.h"
 
@@ -7,6 +9,18 @@ namespace danfoss_eco {
 
 static const char *const TAG = "danfoss_eco.device";
 
+// Identifies a valid HandleCache, bump the version when the layout or property order changes
+static const uint32_t HANDLE_CACHE_MAGIC = 0xDA0F0100 | PROPERTY_COUNT;
+static const uint32_t SNAPSHOT_MAGIC = 0xDA0F5301;
+// Flash wear: the snapshot is written at most this often (and on a clean shutdown)
+static const uint32_t SNAPSHOT_MIN_INTERVAL_MS = 15 * 60 * 1000;
+// The schedule rarely changes outside of this component, so it is only re-read daily
+static const uint32_t SCHEDULE_REFRESH_MS = 24 * 60 * 60 * 1000;
+// Settings older than this are read again before a change is written on top of them
+static const uint32_t SETTINGS_MAX_AGE_MS = 10 * 60 * 1000;
+// How often the valve clock is read to check its drift, and the minimum time between two syncs
+static const uint32_t CLOCK_CHECK_INTERVAL_MS = 6 * 60 * 60 * 1000;
+
 void Device::setup() {
   auto xxtea = this->xxtea_;
 
@@ -21,92 +35,934 @@ void Device::setup() {
     ESP_LOGW(TAG, "No secret key set! Communication will fail.");
   }
 
-  this->p_pin_ = std::make_shared<WritableProperty>(this->parent_, xxtea, SERVICE_SETTINGS, CHARACTERISTIC_PIN);
+  this->p_pin_ = std::make_shared<PinProperty>(this->parent_, xxtea);
   this->p_battery_ = std::make_shared<BatteryProperty>(this->parent_, xxtea);
   this->p_temperature_ = std::make_shared<TemperatureProperty>(this->parent_, xxtea);
   this->p_settings_ = std::make_shared<SettingsProperty>(this->parent_, xxtea);
   this->p_errors_ = std::make_shared<ErrorsProperty>(this->parent_, xxtea);
   this->p_secret_key_ = std::make_shared<SecretKeyProperty>(this->parent_, xxtea);
+  for (uint8_t i = 0; i < SCHEDULE_CHUNKS; i++) {
+    this->p_schedule_[i] = std::make_shared<ScheduleProperty>(this->parent_, xxtea, i);
+  }
+  this->p_current_time_ = std::make_shared<CurrentTimeProperty>(this->parent_, xxtea);
 
   this->properties_ = {
     this->p_pin_, this->p_battery_, this->p_temperature_, 
-    this->p_settings_, this->p_errors_, this->p_secret_key_
+    this->p_settings_, this->p_errors_, this->p_secret_key_,
+    this->p_schedule_[0], this->p_schedule_[1], this->p_schedule_[2],
+    this->p_current_time_
   };
+
+  uint64_t address = this->parent_->parent()->get_address();
+  this->handle_pref_ = global_preferences->make_preference<HandleCache>(
+      fnv1_hash(str_sprintf("danfoss_eco_handles_%012llx", (unsigned long long) address)), true);
+  this->load_handles_();
+  this->snapshot_pref_ = global_preferences->make_preference<StateSnapshot>(
+      fnv1_hash(str_sprintf("danfoss_eco_state_%012llx", (unsigned long long) address)), true);
+}
+
+bool Device::is_ready() const {
+  auto state = this->parent_->node_state;
+  return state == esp32_ble_tracker::ClientState::ESTABLISHED ||
+         (this->fast_start_ && state == esp32_ble_tracker::ClientState::CONNECTED);
 }
 
 void Device::loop() {
-  if (this->parent_->node_state != esp32_ble_tracker::ClientState::ESTABLISHED) {
-    while (!this->commands_.empty()) {
-      delete this->commands_.front();
-      this->commands_.pop();
+  if (!this->is_ready()) {
+    // Commands queued while disconnected are kept for the next session, of the ones
+    // caught by a dropped link only user changes are (polling queues reads again)
+    if (this->was_established_) {
+      this->keep_interactive_writes_();
+      this->was_established_ = false;
+    }
+    // Connect latency runs from the first loop which sees the attempt until the link is established
+    auto state = this->parent_->node_state;
+    if (state == esp32_ble_tracker::ClientState::CONNECTING) {
+      if (!this->connecting_) {
+        this->connecting_ = true;
+        this->connect_started_at_ = millis();
+      }
+    } else if (state != esp32_ble_tracker::ClientState::CONNECTED) {
+      this->connecting_ = false;
     }
     return;
   }
+  this->was_established_ = true;
+  this->update_link_speed_();
 
-  if (!this->commands_.empty()) {
-    Command *cmd = this->commands_.front();
-    if (cmd->execute(this->parent_->parent())) {
-      delete cmd;
-      this->commands_.pop();
+  if (this->commands_.empty()) return;
+
+  // One command on the air at a time: the next one is only sent once the
+  // valve has responded to the current one, or it has timed out
+  Command *cmd = &this->commands_.front();
+  uint32_t now = millis();
+  if (cmd->state == CommandState::IN_FLIGHT) {
+    if (now - cmd->sent_at < cmd->timeout_ms) return;
+    ESP_LOGW(TAG, "No response for handle 0x%04x (attempt %u)", cmd->property->handle, cmd->attempts);
+    cmd->retry(now);
+  } else if (cmd->state == CommandState::PENDING) {
+    // Cached handles are only confirmed by service discovery, a write to one which has moved would change
+    // another characteristic: writes (the PIN first) wait for it, reads may go ahead
+    if (cmd->type == CommandType::WRITE && !this->discovered_) return;
+    // retry_at is only set by a failed attempt, comparing it before that stalls once millis() passes 2^31
+    if (cmd->attempts > 0 && (int32_t) (now - cmd->retry_at) < 0) return;
+    if (cmd->attempts == 0) this->record_latency_(LatencyStage::QUEUE_WAIT, now - cmd->queued_at);
+    if (!cmd->execute(this->parent_->parent(), now)) {
+      ESP_LOGW(TAG, "Request for handle 0x%04x was rejected by the stack (attempt %u)", cmd->property->handle,
+               cmd->attempts);
+      cmd->retry(now);
+    } else {
+      this->airtime_.on_request(this->request_bytes_(*cmd));
     }
   }
+
+  if (cmd->is_finished()) {
+    if (cmd->state == CommandState::FAILED) {
+      ESP_LOGE(TAG, "Giving up on handle 0x%04x after %u attempts", cmd->property->handle, cmd->attempts);
+    }
+    this->finish_command_();
+  }
+}
+
+void Device::finish_command_() {
+  this->commands_.pop_front();
+  if (this->commands_.empty()) {
+    this->drained_at_ = millis();
+    this->publish_latency_();
+    this->publish_change_counters_();
+    this->publish_airtime_();
+    this->save_snapshot(false);
+  }
 }
 
 void Device::update() {
   ESP_LOGD(TAG, "Device::update() called");
-  if (this->parent_->node_state != esp32_ble_tracker::ClientState::ESTABLISHED) {
+  if (!this->is_ready()) {
     ESP_LOGD(TAG, "BLE not connected, skipping update");
     return;
   }
 
-  ESP_LOGD(TAG, "Reading temperature and battery");
-  this->commands_.push(new Command(CommandType::READ, this->p_temperature_));
-  this->commands_.push(new Command(CommandType::READ, this->p_battery_));
+  ESP_LOGD(TAG, "Reading temperature, battery, errors and settings");
+  this->queue_refresh_({this->p_temperature_.get(), this->p_battery_.get(), this->p_errors_.get(),
+                        this->p_settings_.get()});
+
+  uint32_t now = millis();
+  for (auto &schedule : this->p_schedule_) {
+    if (!schedule->data.known || now - schedule->read_at >= SCHEDULE_REFRESH_MS) {
+      ESP_LOGD(TAG, "Reading weekly schedule");
+      this->queue_refresh_({this->p_schedule_[0].get(), this->p_schedule_[1].get(), this->p_schedule_[2].get()});
+      break;
+    }
+  }
+#ifdef USE_TIME
+  this->check_clock_();
+#endif
+}
+
+void Device::queue_refresh_(std::initializer_list<DeviceProperty *> properties) {
+  DeviceProperty *batch[COMMAND_MAX_BATCH];
+  DeviceProperty *sequential[COMMAND_MAX_BATCH];
+  uint8_t batch_size = 0, sequential_size = 0;
+  // Read Multiple response is a plain concatenation of the values, limited to MTU - 1 bytes
+  uint16_t budget = this->mtu_ - 1;
+  for (auto *prop : properties) {
+    if (prop->handle == INVALID_HANDLE_VAL) continue;
+    if (this->is_read_queued_(prop)) {
+      this->count_coalesced_(this->reads_deduplicated_, "read");
+      continue;
+    }
+    uint16_t len = prop->value_length();
+    if (this->read_multiple_ && len > 0 && len <= budget && batch_size < COMMAND_MAX_BATCH) {
+      batch[batch_size++] = prop;
+      budget -= len;
+    } else if (sequential_size < COMMAND_MAX_BATCH) {
+      sequential[sequential_size++] = prop;
+    }
+  }
+
+  if (batch_size > 1) {
+    this->enqueue_(Command::read_multiple(batch, batch_size));
+  } else if (batch_size == 1) {
+    this->enqueue_(Command(CommandType::READ, batch[0]));
+  }
+  for (uint8_t i = 0; i < sequential_size; i++) {
+    this->enqueue_(Command(CommandType::READ, sequential[i]));
+  }
+}
+
+void Device::fall_back_to_sequential_reads_() {
+  ESP_LOGW(TAG, "Read Multiple is not supported by the valve, falling back to sequential reads");
+  this->read_multiple_ = false;
+
+  Command batch = this->commands_.front();
+  this->finish_command_();
+  for (uint8_t i = batch.batch_size; i > 0; i--) {
+    this->enqueue_(Command(CommandType::READ, batch.batch[i - 1]), true);
+  }
+}
+
+void Device::on_read_multiple_(esp_gatt_status_t status, uint8_t *value, uint16_t value_len) {
+  if (this->commands_.empty() || !this->commands_.front().is_response_to(CommandType::READ_MULTIPLE, 0)) {
+    ESP_LOGD(TAG, "Ignoring unexpected Read Multiple response");
+    return;
+  }
+
+  Command *cmd = &this->commands_.front();
+  this->record_latency_(LatencyStage::ROUND_TRIP, millis() - cmd->sent_at);
+  if (status == ESP_GATT_REQ_NOT_SUPPORTED || status == ESP_GATT_NOT_SUPPORTED) {
+    this->fall_back_to_sequential_reads_();
+    return;
+  }
+  if (status != ESP_GATT_OK) {
+    // Anything else is no reason to give up on batching, the same request is tried again
+    ESP_LOGW(TAG, "Read Multiple failed, status=%d (attempt %u)", status, cmd->attempts);
+    if (status == ESP_GATT_INVALID_HANDLE) this->invalidate_handles_();
+    cmd->retry(millis());
+    if (!cmd->is_finished()) return;
+    ESP_LOGE(TAG, "Giving up on Read Multiple after %u attempts", cmd->attempts);
+    this->finish_command_();
+    return;
+  }
+
+  // Fan the concatenated values out to each property
+  uint16_t offset = 0;
+  for (uint8_t i = 0; i < cmd->batch_size; i++) {
+    DeviceProperty *prop = cmd->batch[i];
+    uint16_t len = prop->value_length();
+    if (offset + len > value_len) {
+      ESP_LOGW(TAG, "Read Multiple response truncated at %u bytes", value_len);
+      break;
+    }
+    // A value the property rejected doesn't replace restored state
+    if (prop->update_state(value + offset, len)) this->on_fresh_read_(prop);
+    offset += len;
+  }
+  cmd->complete(true);
+  this->finish_command_();
 }
 
 void Device::control(const climate::ClimateCall &call) {
   if (call.get_target_temperature().has_value()) {
     float temp = *call.get_target_temperature();
-    auto data = std::make_unique<TemperatureData>(this->xxtea_);
-    data->target_temperature = temp;
-    data->room_temperature = this->parent_->current_temperature; 
-    
-    this->p_temperature_->data = std::move(data);
-    this->commands_.push(new Command(CommandType::WRITE, this->p_temperature_));
+    auto &data = this->p_temperature_->setpoint;
+    data.target_temperature = temp;
+    data.room_temperature = this->parent_->current_temperature;
+
+    this->enqueue_(Command(
+        CommandType::WRITE, this->p_temperature_.get(),
+        [](void *context, bool success) {
+          if (success) return;
+          // Re-sync the entity with what the valve actually has
+          auto *device = static_cast<Device *>(context);
+          ESP_LOGW(TAG, "Failed to set target temperature, reading back current state");
+          device->p_temperature_->forget_value();
+          device->enqueue_(Command::interactive_read(device->p_temperature_.get()));
+        },
+        this));
+
+    // Show the new setpoint right away, instead of waiting for the next read
+    this->parent_->target_temperature = temp;
+    this->parent_->publish_state();
+  }
+
+  if (call.get_mode().has_value()) {
+    auto &data = this->p_settings_->data;
+    data.pending_mode = *call.get_mode();
+    data.pending_mask |= SETTINGS_MODE;
+    this->sync_settings_();
+
+    this->parent_->mode = data.pending_mode;
+    this->parent_->publish_state();
+  }
+}
+
+void Device::set_temperature_limits(float min, float max) {
+  auto &data = this->p_settings_->data;
+  data.pending_min = min;
+  data.pending_max = max;
+  data.pending_mask |= SETTINGS_LIMITS;
+  this->sync_settings_();
+  this->p_settings_->publish();
+}
+
+void Device::sync_settings_() {
+  auto *prop = this->p_settings_.get();
+  if (prop->data.pending_mask == 0) return;
+  if (!prop->data.known || millis() - prop->read_at > SETTINGS_MAX_AGE_MS) {
+    // Changes are written on top of the current value, the write is queued once it has been read
+    this->enqueue_(Command::interactive_read(prop));
+    return;
+  }
+  if (!prop->data.has_changes()) {
+    ESP_LOGD(TAG, "Settings unchanged, nothing to write");
+    return;
+  }
+  this->enqueue_(Command(
+      CommandType::WRITE, prop,
+      [](void *context, bool success) {
+        auto *device = static_cast<Device *>(context);
+        auto &data = device->p_settings_->data;
+        if (success) {
+          data.commit();
+          return;
+        }
+        // The cached value can't be trusted any more, re-sync the entity with the valve
+        ESP_LOGW(TAG, "Failed to write settings, reading back current state");
+        data.known = false;
+        data.pending_mask = 0;
+        device->p_settings_->forget_value();
+        device->enqueue_(Command::interactive_read(device->p_settings_.get()));
+      },
+      this));
+}
+
+bool Device::enqueue_(const Command &cmd, bool front) {
+  if (cmd.type == CommandType::WRITE) {
+    // Payload is packed from the property when sent, so a write which is still waiting
+    // in the queue already carries the latest value
+    for (uint8_t i = 0; i < this->commands_.size(); i++) {
+      const Command &queued = this->commands_[i];
+      if (queued.type == CommandType::WRITE && queued.property == cmd.property &&
+          queued.state == CommandState::PENDING) {
+        if (this->is_user_write_(cmd)) this->count_coalesced_(this->writes_coalesced_, "write");
+        return true;
+      }
+    }
+  } else if (cmd.type == CommandType::READ && this->is_read_queued_(cmd.property)) {
+    if (cmd.priority != CommandPriority::INTERACTIVE || !this->drop_background_read_(cmd.property)) {
+      this->count_coalesced_(this->reads_deduplicated_, "read");
+      return true;
+    }
+    // The background read was dropped, this one is queued in its place further ahead
+  }
+
+  if (this->commands_.full() && !this->make_room_(cmd)) {
+    this->commands_dropped_++;
+    ESP_LOGW(TAG, "Command queue full (%u), dropping %s for handle 0x%04x", this->commands_.capacity(),
+             cmd.type == CommandType::WRITE ? "write" : "read", cmd.property->handle);
+    return false;
+  }
+
+  uint8_t high_water_mark = this->commands_.high_water_mark();
+  if (front) {
+    this->commands_.push_front(cmd);
+    this->commands_.front().queued_at = millis();
+  } else if (cmd.priority == CommandPriority::INTERACTIVE) {
+    uint8_t i = this->interactive_position_();
+    this->commands_.insert(i, cmd);
+    this->commands_[i].queued_at = millis();
+  } else {
+    this->commands_.push_back(cmd);
+    this->commands_[this->commands_.size() - 1].queued_at = millis();
+  }
+  if (this->commands_.high_water_mark() > high_water_mark) {
+    ESP_LOGD(TAG, "Command queue high-water mark: %u/%u", this->commands_.high_water_mark(),
+             this->commands_.capacity());
+  }
+  return true;
+}
+
+bool Device::make_room_(const Command &cmd) {
+  // Full ring policy: reads are dropped (the next poll queues them again), while writes
+  // evict the newest read which isn't on the air yet
+  if (cmd.type != CommandType::WRITE) return false;
+  for (uint8_t i = this->commands_.size(); i > 0; i--) {
+    const Command &queued = this->commands_[i - 1];
+    if (queued.type != CommandType::WRITE && queued.state == CommandState::PENDING) {
+      ESP_LOGD(TAG, "Command queue full, evicting read of handle 0x%04x", queued.property->handle);
+      this->commands_.erase(i - 1);
+      this->commands_dropped_++;
+      return true;
+    }
+  }
+  return false;
+}
+
+uint8_t Device::interactive_position_() {
+  // Ahead of the background commands at the back of the queue which haven't been sent yet,
+  // but behind anything already overtaken COMMAND_MAX_OVERTAKES times, so polling isn't starved
+  uint8_t pos = this->commands_.size();
+  while (pos > 0) {
+    const Command &queued = this->commands_[pos - 1];
+    if (queued.priority == CommandPriority::INTERACTIVE || queued.state != CommandState::PENDING ||
+        queued.attempts > 0 || queued.overtaken >= COMMAND_MAX_OVERTAKES)
+      break;
+    pos--;
+  }
+  for (uint8_t i = pos; i < this->commands_.size(); i++) {
+    this->commands_[i].overtaken++;
+  }
+  return pos;
+}
+
+bool Device::drop_background_read_(const DeviceProperty *property) {
+  for (uint8_t i = 0; i < this->commands_.size(); i++) {
+    const Command &queued = this->commands_[i];
+    if (queued.type == CommandType::READ && queued.property == property &&
+        queued.priority == CommandPriority::BACKGROUND && queued.state == CommandState::PENDING) {
+      this->commands_.erase(i);
+      return true;
+    }
+  }
+  return false;
+}
+
+bool Device::is_user_write_(const Command &cmd) const {
+  return cmd.type == CommandType::WRITE && cmd.priority == CommandPriority::INTERACTIVE &&
+         cmd.property != this->p_pin_.get();
+}
+
+void Device::keep_interactive_writes_() {
+  for (uint8_t i = this->commands_.size(); i > 0; i--) {
+    Command &cmd = this->commands_[i - 1];
+    // Only user writes are kept, the PIN is written again at the start of every session
+    if (!this->is_user_write_(cmd)) {
+      this->commands_.erase(i - 1);
+      continue;
+    }
+    // Writes carry absolute values, sending one again which may have reached the valve is harmless
+    cmd.state = CommandState::PENDING;
+    cmd.attempts = 0;
+    cmd.retry_at = 0;
+  }
+  if (!this->commands_.empty()) {
+    ESP_LOGD(TAG, "Link dropped, keeping %u write(s) for the next session", this->commands_.size());
+  }
+}
+
+bool Device::is_read_queued_(const DeviceProperty *property) const {
+  for (uint8_t i = 0; i < this->commands_.size(); i++) {
+    if (this->commands_[i].reads(property)) return true;
+  }
+  return false;
+}
+
+void Device::count_coalesced_(uint32_t &counter, const char *kind) {
+  counter++;
+  ESP_LOGD(TAG, "Merged duplicate %s into queued command (%" PRIu32 " writes coalesced, %" PRIu32 " reads deduplicated)",
+           kind, this->writes_coalesced_, this->reads_deduplicated_);
+  if (this->parent_->coalesced_commands() != nullptr) {
+    this->parent_->coalesced_commands()->publish_state(this->writes_coalesced_ + this->reads_deduplicated_);
+  }
+}
+
+void Device::record_latency_(LatencyStage stage, uint32_t ms) {
+  auto index = static_cast<uint8_t>(stage);
+  this->latency_[index].record(ms);
+  this->latency_updated_ |= 1 << index;
+  ESP_LOGV(TAG, "%s latency: %" PRIu32 " ms", latency_stage_to_string(stage), ms);
+}
+
+void Device::publish_latency_() {
+  for (uint8_t i = 0; i < LATENCY_STAGE_COUNT; i++) {
+    if ((this->latency_updated_ & (1 << i)) == 0) continue;
+    auto stage = static_cast<LatencyStage>(i);
+    for (uint8_t j = 0; j < LATENCY_STAT_COUNT; j++) {
+      auto stat = static_cast<LatencyStat>(j);
+      auto *sens = this->parent_->latency_sensor(stage, stat);
+      if (sens != nullptr) sens->publish_state(this->latency_[i].value(stat));
+    }
+  }
+  this->latency_updated_ = 0;
+}
+
+void Device::publish_change_counters_() {
+  uint32_t skipped = 0, suppressed = 0;
+  for (auto &prop : this->properties_) {
+    skipped += prop->decrypts_skipped;
+    suppressed += prop->publishes_suppressed;
+  }
+  if (skipped != this->decrypts_skipped_) {
+    this->decrypts_skipped_ = skipped;
+    if (this->parent_->skipped_decrypts() != nullptr) this->parent_->skipped_decrypts()->publish_state(skipped);
+  }
+  if (suppressed != this->publishes_suppressed_) {
+    this->publishes_suppressed_ = suppressed;
+    if (this->parent_->suppressed_publishes() != nullptr) {
+      this->parent_->suppressed_publishes()->publish_state(suppressed);
+    }
+  }
+}
+
+uint16_t Device::request_bytes_(const Command &cmd) const {
+  // ATT request PDUs: opcode and handle(s), plus the value for writes
+  switch (cmd.type) {
+    case CommandType::READ:
+      return 3;
+    case CommandType::READ_MULTIPLE:
+      return 1 + 2 * cmd.batch_size;
+    default:
+      return 3 + static_cast<WritableProperty *>(cmd.property)->payload_length();
+  }
+}
+
+void Device::publish_airtime_() {
+  uint32_t now = millis();
+  const auto &model = this->parent_->energy_model();
+  for (uint8_t i = 0; i < AIRTIME_STAT_COUNT; i++) {
+    auto stat = static_cast<AirtimeStat>(i);
+    auto *sens = this->parent_->airtime_sensor(stat);
+    if (sens != nullptr) sens->publish_state(this->airtime_.value(stat, model, now));
+  }
+}
+
+void Device::dump_config() {
+  ESP_LOGCONFIG(TAG, "  Coalesced Writes: %" PRIu32, this->writes_coalesced_);
+  ESP_LOGCONFIG(TAG, "  Deduplicated Reads: %" PRIu32, this->reads_deduplicated_);
+  ESP_LOGCONFIG(TAG, "  Unchanged Reads: %" PRIu32 " decrypts skipped, %" PRIu32 " publishes suppressed",
+                this->decrypts_skipped_, this->publishes_suppressed_);
+  uint32_t now = millis();
+  ESP_LOGCONFIG(TAG, "  Airtime: %" PRIu32 " s connected, %" PRIu32 " connections (%" PRIu32 " dropped), %" PRIu32
+                " operations, %" PRIu32 " bytes",
+                this->airtime_.connected_ms(now) / 1000, this->airtime_.connections(), this->airtime_.reconnects(),
+                this->airtime_.operations(), this->airtime_.bytes());
+  if (this->conn_interval_ != 0) {
+    ESP_LOGCONFIG(TAG, "  Connection Parameters: interval %.2f ms, latency %u, timeout %u ms (last negotiated)",
+                  this->conn_interval_ * 1.25f, this->conn_latency_, this->conn_timeout_ * 10);
+  }
+  ESP_LOGCONFIG(TAG, "  Estimated Battery Drain: %.3f mAh",
+                this->airtime_.battery_drain(this->parent_->energy_model(), now));
+  ESP_LOGCONFIG(TAG, "  Command Queue: high-water mark %u/%u, %" PRIu32 " dropped", this->commands_.high_water_mark(),
+                this->commands_.capacity(), this->commands_dropped_);
+  for (uint8_t i = 0; i < LATENCY_STAGE_COUNT; i++) {
+    auto &histogram = this->latency_[i];
+    if (histogram.count() == 0) continue;
+    ESP_LOGCONFIG(TAG, "  %s Latency: p50 %" PRIu32 " ms, p95 %" PRIu32 " ms, max %" PRIu32 " ms (%" PRIu32 " samples)",
+                  latency_stage_to_string(static_cast<LatencyStage>(i)), histogram.percentile(50),
+                  histogram.percentile(95), histogram.max(), histogram.count());
+  }
+
+  static const char *const DAY_NAMES[SCHEDULE_DAYS] = {"Mon", "Tue", "Wed", "Thu", "Fri", "Sat", "Sun"};
+  for (uint8_t day = 0; day < SCHEDULE_DAYS; day++) {
+    auto &data = this->p_schedule_[day / SCHEDULE_DAYS_PER_CHUNK]->data;
+    if (!data.known) continue;
+    auto schedule = data.day(day % SCHEDULE_DAYS_PER_CHUNK);
+    const auto *p = schedule.periods;
+    ESP_LOGCONFIG(TAG, "  Schedule %s: %02u:%02u-%02u:%02u, %02u:%02u-%02u:%02u, %02u:%02u-%02u:%02u", DAY_NAMES[day],
+                  p[0].start / 2, p[0].start % 2 * 30, p[0].end / 2, p[0].end % 2 * 30, p[1].start / 2,
+                  p[1].start % 2 * 30, p[1].end / 2, p[1].end % 2 * 30, p[2].start / 2, p[2].start % 2 * 30,
+                  p[2].end / 2, p[2].end % 2 * 30);
   }
 }
 
 void Device::gattc_event_handler(esp_gattc_cb_event_t event, esp_gatt_if_t gattc_if, esp_ble_gattc_cb_param_t *param) {
   switch (event) {
     case ESP_GATTC_SEARCH_CMPL_EVT:
-      for (auto &prop : this->properties_) {
-        prop->init_handle(this->parent_->parent());
-      }
-      this->write_pin();
+      this->on_search_complete_();
       break;
     case ESP_GATTC_READ_CHAR_EVT:
-      if (param->read.status == ESP_GATT_OK) {
-        for (auto &prop : this->properties_) {
-          if (prop->handle == param->read.handle) {
-            prop->update_state(param->read.value, param->read.value_len);
-            break;
-          }
-        }
+      this->airtime_.on_response(1 + param->read.value_len);
+      this->on_response_(CommandType::READ, param->read.handle, param->read.status, param->read.value,
+                         param->read.value_len);
+      break;
+    case ESP_GATTC_READ_MULTIPLE_EVT:
+      this->airtime_.on_response(1 + param->read.value_len);
+      this->on_read_multiple_(param->read.status, param->read.value, param->read.value_len);
+      break;
+    case ESP_GATTC_OPEN_EVT:
+      if (param->open.status == ESP_GATT_OK) {
+        this->mtu_ = param->open.mtu;
+        this->airtime_.on_open(millis());
+        this->on_open_();
       }
       break;
+    case ESP_GATTC_CFG_MTU_EVT:
+      if (param->cfg_mtu.status == ESP_GATT_OK) this->mtu_ = param->cfg_mtu.mtu;
+      break;
+    case ESP_GATTC_DISCONNECT_EVT:
+      this->mtu_ = ESP_GATT_DEF_BLE_MTU_SIZE;
+      this->fast_start_ = false;
+      this->discovered_ = false;
+      this->link_speed_ = LinkSpeed::DEFAULT;
+      this->airtime_.on_disconnect(millis(), !this->commands_.empty());
+      this->publish_airtime_();
+      break;
+    case ESP_GATTC_WRITE_CHAR_EVT:
+      this->airtime_.on_response(1);
+      this->on_response_(CommandType::WRITE, param->write.handle, param->write.status, nullptr, 0);
+      break;
     default:
       break;
   }
 }
 
+void Device::on_response_(CommandType type, uint16_t handle, esp_gatt_status_t status, uint8_t *value,
+                          uint16_t value_len) {
+  if (this->commands_.empty() || !this->commands_.front().is_response_to(type, handle)) {
+    ESP_LOGD(TAG, "Ignoring unexpected response for handle 0x%04x", handle);
+    return;
+  }
+
+  Command *cmd = &this->commands_.front();
+  this->record_latency_(LatencyStage::ROUND_TRIP, millis() - cmd->sent_at);
+  if (status != ESP_GATT_OK) {
+    ESP_LOGW(TAG, "Request for handle 0x%04x failed, status=%d (attempt %u)", handle, status, cmd->attempts);
+    if (status == ESP_GATT_INVALID_HANDLE) this->invalidate_handles_();
+    cmd->retry(millis());
+    if (!cmd->is_finished()) return;
+    ESP_LOGE(TAG, "Giving up on handle 0x%04x after %u attempts", handle, cmd->attempts);
+  } else {
+    if (type == CommandType::READ) {
+      if (cmd->property->update_state(value, value_len)) this->on_fresh_read_(cmd->property);
+    } else if (this->is_user_write_(*cmd)) {
+      this->record_latency_(LatencyStage::WRITE_ACK, millis() - cmd->queued_at);
+    }
+    cmd->complete(true);
+  }
+  this->finish_command_();
+}
+
+void Device::on_open_() {
+  this->opened_at_ = millis();
+  // Discovery and the first reads run at the short interval too
+  this->drained_at_ = this->opened_at_;
+  this->request_link_speed_(LinkSpeed::FAST);
+  this->discovered_ = false;
+  if (!this->handles_known_) return;
+  // Reads sent now are queued by the stack until its service discovery completes,
+  // so the first ones go out without waiting for another round through the event loop
+  ESP_LOGD(TAG, "Using known GATT handles for reads, not waiting for service discovery");
+  this->fast_start_ = true;
+  this->write_pin();
+}
+
+void Device::on_search_complete_() {
+  uint32_t now = millis();
+  this->record_latency_(LatencyStage::DISCOVERY, now - this->opened_at_);
+  if (this->connecting_) {
+    this->record_latency_(LatencyStage::CONNECT, now - this->connect_started_at_);
+    this->connecting_ = false;
+  }
+
+  // Discovery is done anyway, so the handles in use are validated against it
+  bool changed = false;
+  for (auto &prop : this->properties_) {
+    uint16_t known = prop->handle;
+    prop->handle = INVALID_HANDLE_VAL;
+    prop->init_handle(this->parent_->parent());
+    changed |= prop->handle != known;
+  }
+
+  if (!this->handles_known_ || changed) {
+    if (this->handles_known_) ESP_LOGW(TAG, "GATT handles changed, updating cache");
+    this->save_handles_();
+  }
+  if (this->fast_start_ && changed && !this->commands_.empty() &&
+      this->commands_.front().state == CommandState::IN_FLIGHT) {
+    // Read sent to a stale handle, its response (if any) won't match any more
+    this->commands_.front().state = CommandState::PENDING;
+  }
+  this->discovered_ = true;
+  // With a fast start the PIN write is already queued, held until now
+  if (!this->fast_start_) {
+    this->write_pin();
+  }
+}
+
+void Device::update_link_speed_() {
+  if (!this->parent_->connection_params().enabled) return;
+  if (!this->commands_.empty()) {
+    this->request_link_speed_(LinkSpeed::FAST);
+  } else if (millis() - this->drained_at_ >= this->parent_->connection_params().idle_delay) {
+    this->request_link_speed_(LinkSpeed::SLOW);
+  }
+}
+
+void Device::request_link_speed_(LinkSpeed speed) {
+  const auto &params = this->parent_->connection_params();
+  if (!params.enabled || speed == this->link_speed_) return;
+  // Requested once per phase, the valve may still settle on other values (see gap_event_handler)
+  this->link_speed_ = speed;
+
+  esp_ble_conn_update_params_t conn_params{};
+  memcpy(conn_params.bda, this->parent_->parent()->get_remote_bda(), sizeof(esp_bd_addr_t));
+  if (speed == LinkSpeed::FAST) {
+    conn_params.min_int = params.fast_interval;
+    conn_params.max_int = params.fast_interval;
+    conn_params.latency = 0;
+  } else {
+    conn_params.min_int = params.slow_interval;
+    conn_params.max_int = params.slow_interval;
+    conn_params.latency = params.slow_latency;
+  }
+  conn_params.timeout = params.timeout;
+  ESP_LOGD(TAG, "Requesting %s connection interval (%.2f ms, latency %u)",
+           speed == LinkSpeed::FAST ? "fast" : "slow", conn_params.max_int * 1.25f, conn_params.latency);
+  auto status = esp_ble_gap_update_conn_params(&conn_params);
+  if (status != ESP_OK) {
+    ESP_LOGW(TAG, "Connection parameter update rejected by the stack, status=%d", status);
+  }
+}
+
+void Device::gap_event_handler(esp_gap_ble_cb_event_t event, esp_ble_gap_cb_param_t *param) {
+  if (event != ESP_GAP_BLE_UPDATE_CONN_PARAMS_EVT) return;
+  auto &update = param->update_conn_params;
+  // Events are delivered to every client, only this valve's link is of interest
+  if (memcmp(update.bda, this->parent_->parent()->get_remote_bda(), sizeof(esp_bd_addr_t)) != 0) return;
+  if (update.status != ESP_BT_STATUS_SUCCESS) {
+    ESP_LOGW(TAG, "Connection parameter update failed, status=%d", update.status);
+    return;
+  }
+  this->conn_interval_ = update.conn_int;
+  this->conn_latency_ = update.latency;
+  this->conn_timeout_ = update.timeout;
+  ESP_LOGD(TAG, "Connection parameters: interval %.2f ms, latency %u, timeout %u ms", update.conn_int * 1.25f,
+           update.latency, update.timeout * 10);
+}
+
+void Device::load_handles_() {
+  HandleCache cache{};
+  if (!this->handle_pref_.load(&cache) || cache.magic != HANDLE_CACHE_MAGIC) return;
+  // The PIN and temperature characteristics exist on every valve, anything else is a corrupt entry
+  if (cache.handles[0] == INVALID_HANDLE_VAL || cache.handles[2] == INVALID_HANDLE_VAL) return;
+  for (uint8_t i = 0; i < PROPERTY_COUNT; i++) {
+    this->properties_[i]->handle = cache.handles[i];
+  }
+  this->handles_known_ = true;
+  ESP_LOGD(TAG, "Loaded cached GATT handles");
+}
+
+void Device::save_handles_() {
+  HandleCache cache{};
+  cache.magic = HANDLE_CACHE_MAGIC;
+  for (uint8_t i = 0; i < PROPERTY_COUNT; i++) {
+    cache.handles[i] = this->properties_[i]->handle;
+  }
+  this->handle_pref_.save(&cache);
+  this->handles_known_ = true;
+}
+
+void Device::invalidate_handles_() {
+  if (!this->handles_known_) return;
+  ESP_LOGW(TAG, "Cached GATT handles rejected by the valve, waiting for service discovery next time");
+  HandleCache cache{};
+  this->handle_pref_.save(&cache);
+  this->handles_known_ = false;
+}
+
+void Device::restore_snapshot() {
+  StateSnapshot snapshot{};
+  if (!this->snapshot_pref_.load(&snapshot) || snapshot.magic != SNAPSHOT_MAGIC || snapshot.valid == 0) {
+    if (this->parent_->stale() != nullptr) this->parent_->stale()->publish_state(false);
+    return;
+  }
+  ESP_LOGI(TAG, "Restored last known state, stale until read from the valve");
+  this->snapshot_ = snapshot;
+  this->stale_ = snapshot.valid;
+  if (this->parent_->stale() != nullptr) this->parent_->stale()->publish_state(true);
+
+  if (snapshot.valid & SNAPSHOT_SETTINGS) {
+    auto &data = this->p_settings_->data;
+    data.device_mode = static_cast<climate::ClimateMode>(snapshot.device_mode);
+    data.temperature_min = snapshot.temperature_min;
+    data.temperature_max = snapshot.temperature_max;
+    this->p_settings_->publish();
+  }
+  if (snapshot.valid & SNAPSHOT_TEMPERATURE) {
+    auto &data = this->p_temperature_->data;
+    data.room_temperature = snapshot.room_temperature;
+    data.target_temperature = snapshot.target_temperature;
+    this->p_temperature_->publish();
+  }
+  if (snapshot.valid & SNAPSHOT_ERRORS) {
+    auto &data = this->p_errors_->data;
+    data.E9_VALVE_DOES_NOT_CLOSE = snapshot.errors & (1 << 0);
+    data.E10_INVALID_TIME = snapshot.errors & (1 << 1);
+    data.E14_LOW_BATTERY = snapshot.errors & (1 << 2);
+    data.E15_VERY_LOW_BATTERY = snapshot.errors & (1 << 3);
+    this->p_errors_->publish();
+  }
+  if (snapshot.valid & SNAPSHOT_BATTERY) {
+    this->p_battery_->level = snapshot.battery_level;
+    this->p_battery_->publish();
+  }
+}
+
+void Device::save_snapshot(bool force) {
+  StateSnapshot snapshot = this->take_snapshot_();
+  if (snapshot.valid == 0 || memcmp(&snapshot, &this->snapshot_, sizeof(snapshot)) == 0) return;
+  uint32_t now = millis();
+  if (!force && this->snapshot_saved_ && now - this->snapshot_saved_at_ < SNAPSHOT_MIN_INTERVAL_MS) return;
+
+  ESP_LOGD(TAG, "Saving state snapshot");
+  this->snapshot_pref_.save(&snapshot);
+  this->snapshot_ = snapshot;
+  this->snapshot_saved_ = true;
+  this->snapshot_saved_at_ = now;
+}
+
+StateSnapshot Device::take_snapshot_() const {
+  StateSnapshot snapshot{};
+  snapshot.magic = SNAPSHOT_MAGIC;
+  snapshot.valid = this->snapshot_.valid | this->fresh_;
+  snapshot.battery_level = this->p_battery_->level;
+
+  auto &settings = this->p_settings_->data;
+  snapshot.device_mode = settings.device_mode;
+  snapshot.temperature_min = settings.temperature_min;
+  snapshot.temperature_max = settings.temperature_max;
+
+  auto &temperature = this->p_temperature_->data;
+  snapshot.room_temperature = temperature.room_temperature;
+  snapshot.target_temperature = temperature.target_temperature;
+
+  auto &errors = this->p_errors_->data;
+  snapshot.errors = (errors.E9_VALVE_DOES_NOT_CLOSE << 0) | (errors.E10_INVALID_TIME << 1) |
+                    (errors.E14_LOW_BATTERY << 2) | (errors.E15_VERY_LOW_BATTERY << 3);
+  return snapshot;
+}
+
+void Device::on_fresh_read_(const DeviceProperty *prop) {
+  uint8_t part = 0;
+  switch (prop->characteristic()) {
+    case CharacteristicId::TEMPERATURE:
+      part = SNAPSHOT_TEMPERATURE;
+      break;
+    case CharacteristicId::SETTINGS:
+      part = SNAPSHOT_SETTINGS;
+      this->sync_settings_();
+      break;
+    case CharacteristicId::ERRORS:
+      part = SNAPSHOT_ERRORS;
+#ifdef USE_TIME
+      if (this->p_errors_->data.E10_INVALID_TIME) this->sync_clock_("E10 raised");
+#endif
+      break;
+    case CharacteristicId::BATTERY:
+      part = SNAPSHOT_BATTERY;
+      break;
+#ifdef USE_TIME
+    case CharacteristicId::CURRENT_TIME:
+      this->on_clock_read_();
+      break;
+#endif
+    case CharacteristicId::SCHEDULE_1:
+    case CharacteristicId::SCHEDULE_2:
+    case CharacteristicId::SCHEDULE_3:
+      this->sync_schedule_(static_cast<ScheduleProperty *>(const_cast<DeviceProperty *>(prop)));
+      break;
+    default:
+      break;
+  }
+  this->fresh_ |= part;
+
+  if ((this->stale_ & part) == 0) return;
+  this->stale_ &= ~part;
+  if (this->stale_ == 0) {
+    ESP_LOGD(TAG, "Restored state fully replaced by values read from the valve");
+    if (this->parent_->stale() != nullptr) this->parent_->stale()->publish_state(false);
+  }
+}
+
+void Device::set_schedule_day(uint8_t day, const ScheduleDay &schedule) {
+  if (day >= SCHEDULE_DAYS) return;
+  auto *prop = this->p_schedule_[day / SCHEDULE_DAYS_PER_CHUNK].get();
+  uint8_t i = day % SCHEDULE_DAYS_PER_CHUNK;
+  prop->data.pending[i] = schedule;
+  prop->data.pending_mask |= 1 << i;
+  this->sync_schedule_(prop);
+}
+
+void Device::sync_schedule_(ScheduleProperty *prop) {
+  if (prop->data.pending_mask == 0) return;
+  if (!prop->data.known) {
+    // Days are merged into the current value, the write is queued once it has been read
+    this->enqueue_(Command::interactive_read(prop));
+    return;
+  }
+  if (!prop->data.has_changes()) {
+    ESP_LOGD(TAG, "Schedule unchanged, nothing to write");
+    return;
+  }
+  // Only the characteristic holding the edited days is written
+  static_assert(SCHEDULE_CHUNKS == 3, "one write callback per schedule chunk");
+  static const CommandCallback CALLBACKS[SCHEDULE_CHUNKS] = {
+      &Device::on_schedule_written_<0>, &Device::on_schedule_written_<1>, &Device::on_schedule_written_<2>};
+  this->enqueue_(Command(CommandType::WRITE, prop, CALLBACKS[prop->data.chunk], this));
+}
+
+template<uint8_t CHUNK> void Device::on_schedule_written_(void *context, bool success) {
+  auto *device = static_cast<Device *>(context);
+  auto *prop = device->p_schedule_[CHUNK].get();
+  if (success) {
+    prop->data.commit();
+    return;
+  }
+  // The pending days are kept, they are compared against what the valve has and written again once
+  // the chunk has been read back, instead of waiting for the daily schedule refresh
+  ESP_LOGW(TAG, "Failed to write schedule, reading back current state");
+  prop->data.known = false;
+  prop->forget_value();
+  device->enqueue_(Command::interactive_read(prop));
+}
+
+#ifdef USE_TIME
+void Device::check_clock_() {
+  auto *time = this->parent_->time_source();
+  if (time == nullptr || !time->now().is_valid()) return;
+  // Not found by discovery (older firmware), a request to it would only come back as an invalid handle
+  if (this->p_current_time_->handle == INVALID_HANDLE_VAL) return;
+  if (this->clock_checked_ && millis() - this->clock_checked_at_ < CLOCK_CHECK_INTERVAL_MS) return;
+  // Stamped when queued, so a read which never completes isn't queued again on every poll
+  if (!this->enqueue_(Command(CommandType::READ, this->p_current_time_.get()))) return;
+  this->clock_checked_ = true;
+  this->clock_checked_at_ = millis();
+}
+
+void Device::on_clock_read_() {
+  this->clock_checked_ = true;
+  this->clock_checked_at_ = millis();
+  auto *time = this->parent_->time_source();
+  if (time == nullptr) return;
+  ESPTime now = time->now();
+  if (!now.is_valid()) return;
+
+  int64_t expected = (int64_t) now.timestamp + ESPTime::timezone_offset();
+  int64_t drift = (int64_t) this->p_current_time_->data.time_local - expected;
+  ESP_LOGD(TAG, "Valve clock drift: %" PRId32 " s", (int32_t) drift);
+  if ((drift < 0 ? -drift : drift) * 1000 > this->parent_->time_sync_threshold()) {
+    this->sync_clock_("drift above threshold");
+  }
+}
+
+void Device::sync_clock_(const char *reason) {
+  auto *time = this->parent_->time_source();
+  if (time == nullptr || this->p_current_time_->handle == INVALID_HANDLE_VAL) return;
+  ESPTime now = time->now();
+  if (!now.is_valid()) return;
+  // E10 stays raised until the valve re-evaluates it, don't write the clock on every errors read
+  if (this->clock_synced_ && millis() - this->clock_synced_at_ < CLOCK_CHECK_INTERVAL_MS) return;
+
+  ESP_LOGI(TAG, "Setting valve clock (%s)", reason);
+  auto &data = this->p_current_time_->data;
+  data.time_offset = ESPTime::timezone_offset();
+  data.time_local = (uint32_t) (now.timestamp + data.time_offset);
+  this->clock_synced_ = true;
+  this->clock_synced_at_ = millis();
+  Command cmd(
+      CommandType::WRITE, this->p_current_time_.get(),
+      [](void *context, bool success) {
+        auto *device = static_cast<Device *>(context);
+        if (success) {
+          device->clock_checked_ = true;
+          device->clock_checked_at_ = millis();
+          return;
+        }
+        ESP_LOGW(TAG, "Failed to set valve clock");
+        device->clock_synced_ = false;
+      },
+      this);
+  // Housekeeping, not something the user is waiting for
+  cmd.priority = CommandPriority::BACKGROUND;
+  this->enqueue_(cmd);
+}
+#endif
+
 void Device::write_pin() {
   if (this->pin_code_ == 0) return;
-  uint8_t pin_data[4];
-  pin_data[0] = (this->pin_code_ >> 0) & 0xFF;
-  pin_data[1] = (this->pin_code_ >> 8) & 0xFF;
-  pin_data[2] = (this->pin_code_ >> 16) & 0xFF;
-  pin_data[3] = (this->pin_code_ >> 24) & 0xFF;
-  this->p_pin_->write_request(this->parent_->parent(), pin_data, 4);
+  this->p_pin_->data.pin_code = this->pin_code_;
+  // PIN has to be accepted before anything else can be read or written
+  this->enqueue_(Command(CommandType::WRITE, this->p_pin_.get()), true);
 }
 
 void Device::set_pin_code(const std::string &str) {
@@ -126,6 +982,8 @@ void Device::set_secret_key(uint8_t *key, bool persist) {
     return;
   }
   this->xxtea_->set_key(key, 16);
+  // Raw values read with another key don't tell anything about the new one
+  for (auto &prop : this->properties_) prop->forget_value();
 }
 
 } // namespace danfoss_eco
@@ -1,13 +1,56 @@
 #pragma once
 
 #include "esphome/components/ble_client/ble_client.h"
+#include <esp_gap_ble_api.h>
+#include "esphome/core/preferences.h"
 #include "properties.h"
 #include "command.h"
-#include <queue>
+#include "latency.h"
+#include "airtime.h"
+#include <initializer_list>
 
 namespace esphome {
 namespace danfoss_eco {
 
+// Number of properties, in the order of Device::properties_
+static const uint8_t PROPERTY_COUNT = 7 + SCHEDULE_CHUNKS;
+
+/**
+ * GATT handles of a valve, persisted so a reconnect doesn't have to wait for service discovery
+ */
+struct HandleCache {
+  uint32_t magic;
+  uint16_t handles[PROPERTY_COUNT];
+};
+
+// Parts of a StateSnapshot
+static const uint8_t SNAPSHOT_TEMPERATURE = 1 << 0;
+static const uint8_t SNAPSHOT_SETTINGS = 1 << 1;
+static const uint8_t SNAPSHOT_ERRORS = 1 << 2;
+static const uint8_t SNAPSHOT_BATTERY = 1 << 3;
+
+/**
+ * Last decoded state of a valve, persisted so entities have a value right after boot
+ */
+struct StateSnapshot {
+  uint32_t magic;
+  uint8_t valid;  // SNAPSHOT_* parts which hold a value
+  uint8_t battery_level;
+  uint8_t device_mode;  // climate::ClimateMode
+  uint8_t errors;       // E9, E10, E14, E15 from bit 0 up
+  float room_temperature;
+  float target_temperature;
+  float temperature_min;
+  float temperature_max;
+};
+
+// Connection parameters last requested for the link
+enum class LinkSpeed : uint8_t {
+  DEFAULT,  // as set up by the stack, nothing requested yet
+  FAST,     // short interval while commands are queued or in flight
+  SLOW,     // long interval and slave latency once the queue drained
+};
+
 class Device {
  public:
   Device(MyComponent *parent, std::shared_ptr<Xxtea> xxtea) : parent_(parent), xxtea_(xxtea) {}
@@ -17,6 +60,23 @@ class Device {
   void update();
   void control(const climate::ClimateCall &call);
   void gattc_event_handler(esp_gattc_cb_event_t event, esp_gatt_if_t gattc_if, esp_ble_gattc_cb_param_t *param);
+  void gap_event_handler(esp_gap_ble_cb_event_t event, esp_ble_gap_cb_param_t *param);
+  void dump_config();
+
+  bool is_idle() const { return this->commands_.empty(); }
+  // Commands can be sent: the link is established, or open and the handles are already known
+  bool is_ready() const;
+  void set_read_multiple(bool read_multiple) { this->read_multiple_ = read_multiple; }
+
+  // Publishes the state saved before the last reboot, marked stale until read from the valve
+  void restore_snapshot();
+  // Saves the current state, at most every SNAPSHOT_MIN_INTERVAL_MS unless forced
+  void save_snapshot(bool force);
+
+  // Changes one day (0 = Monday) of the weekly schedule, only written if it differs from the valve
+  void set_schedule_day(uint8_t day, const ScheduleDay &schedule);
+  // Changes the valve's min/max temperature limits
+  void set_temperature_limits(float min, float max);
 
   void set_pin_code(const std::string &str);
   void set_secret_key(const std::string &str);
@@ -24,21 +84,108 @@ class Device {
 
  protected:
   void write_pin();
+  // Queues a command, unless it duplicates one already queued. Returns false if it was dropped.
+  bool enqueue_(const Command &cmd, bool front = false);
+  bool make_room_(const Command &cmd);
+  // Where an interactive command goes, counts it as overtaking the commands behind it
+  uint8_t interactive_position_();
+  bool drop_background_read_(const DeviceProperty *property);
+  // Write of a user change: interactive, and not the PIN which is written at the start of every session
+  bool is_user_write_(const Command &cmd) const;
+  // After a dropped link: user writes stay queued for the next session, everything else is discarded
+  void keep_interactive_writes_();
+  bool is_read_queued_(const DeviceProperty *property) const;
+  void count_coalesced_(uint32_t &counter, const char *kind);
+  void finish_command_();
+  void queue_refresh_(std::initializer_list<DeviceProperty *> properties);
+  // The valve doesn't support Read Multiple: the batch in front is split into single reads, batching stays off
+  void fall_back_to_sequential_reads_();
+  void on_read_multiple_(esp_gatt_status_t status, uint8_t *value, uint16_t value_len);
+  void on_response_(CommandType type, uint16_t handle, esp_gatt_status_t status, uint8_t *value, uint16_t value_len);
+  void record_latency_(LatencyStage stage, uint32_t ms);
+  void on_open_();
+  void update_link_speed_();
+  void request_link_speed_(LinkSpeed speed);
+  void on_search_complete_();
+  void load_handles_();
+  void save_handles_();
+  void invalidate_handles_();
+  StateSnapshot take_snapshot_() const;
+  void on_fresh_read_(const DeviceProperty *prop);
+  void sync_schedule_(ScheduleProperty *prop);
+  // Write callback of schedule chunk CHUNK, the context is the Device
+  template<uint8_t CHUNK> static void on_schedule_written_(void *context, bool success);
+  void sync_settings_();
+#ifdef USE_TIME
+  void check_clock_();
+  void on_clock_read_();
+  void sync_clock_(const char *reason);
+#endif
+  void publish_latency_();
+  // Totals of the per-property change detection counters, published when they moved
+  void publish_change_counters_();
+  uint16_t request_bytes_(const Command &cmd) const;
+  void publish_airtime_();
 
   MyComponent *parent_;
   std::shared_ptr<Xxtea> xxtea_;
   std::vector<std::shared_ptr<DeviceProperty>> properties_;
-  std::queue<Command*> commands_;
+  CommandRing<COMMAND_QUEUE_SIZE> commands_;
+  bool was_established_{false};
+  bool read_multiple_{true};
+  uint32_t writes_coalesced_{0};
+  uint32_t reads_deduplicated_{0};
+  uint32_t commands_dropped_{0};
+  uint32_t decrypts_skipped_{0};
+  uint32_t publishes_suppressed_{0};
+  uint16_t mtu_{ESP_GATT_DEF_BLE_MTU_SIZE};
+
+  LatencyHistogram latency_[LATENCY_STAGE_COUNT];
+  uint8_t latency_updated_{0};  // bit per LatencyStage with samples not published yet
+  bool connecting_{false};
+  uint32_t connect_started_at_{0};
+  uint32_t opened_at_{0};
+  AirtimeMeter airtime_;
+
+  LinkSpeed link_speed_{LinkSpeed::DEFAULT};
+  uint32_t drained_at_{0};
+  // Last negotiated values, in 1.25 ms / connection events / 10 ms units
+  uint16_t conn_interval_{0};
+  uint16_t conn_latency_{0};
+  uint16_t conn_timeout_{0};
+
+  ESPPreferenceObject handle_pref_;
+  bool handles_known_{false};
+  // Session was started from known handles at ESP_GATTC_OPEN_EVT, before discovery completed
+  bool fast_start_{false};
+  // Service discovery of this session completed, the handles in use are confirmed and writes may go out
+  bool discovered_{false};
+
+  ESPPreferenceObject snapshot_pref_;
+  StateSnapshot snapshot_{};  // last saved (or restored) snapshot
+  uint8_t fresh_{0};          // SNAPSHOT_* parts read from the valve since boot
+  uint8_t stale_{0};          // SNAPSHOT_* parts restored, but not read from the valve yet
+  bool snapshot_saved_{false};
+  uint32_t snapshot_saved_at_{0};
+
+#ifdef USE_TIME
+  bool clock_checked_{false};
+  uint32_t clock_checked_at_{0};
+  bool clock_synced_{false};
+  uint32_t clock_synced_at_{0};
+#endif
   
   uint32_t pin_code_{0};
   std::string pending_secret_key_;
 
-  std::shared_ptr<WritableProperty> p_pin_;
+  std::shared_ptr<PinProperty> p_pin_;
   std::shared_ptr<BatteryProperty> p_battery_;
   std::shared_ptr<TemperatureProperty> p_temperature_;
   std::shared_ptr<SettingsProperty> p_settings_;
   std::shared_ptr<ErrorsProperty> p_errors_;
   std::shared_ptr<SecretKeyProperty> p_secret_key_;
+  std::shared_ptr<ScheduleProperty> p_schedule_[SCHEDULE_CHUNKS];
+  std::shared_ptr<CurrentTimeProperty> p_current_time_;
 };
 
 } // namespace danfoss_eco
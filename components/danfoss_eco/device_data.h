@@ -1,4 +1,5 @@
 #pragma once
+#include <cstring>
 #include <memory>
 #include <vector>
 #include "xxtea.h"
@@ -9,6 +10,7 @@ namespace danfoss_eco {
 
 /**
  * Base structure for data received from or sent to the valve.
+ * Instances are owned by their property and decoded in place, so updates don't allocate.
  */
 struct DeviceData {
   virtual ~DeviceData() = default;
@@ -19,11 +21,27 @@ struct DeviceData {
  */
 struct WritableData : public DeviceData {
   uint16_t length;
-  std::shared_ptr<Xxtea> xxtea;
-  WritableData(uint16_t len, std::shared_ptr<Xxtea> &xt) : length(len), xxtea(xt) {}
+  Xxtea *xxtea;
+  WritableData(uint16_t len, Xxtea *xt) : length(len), xxtea(xt) {}
   virtual void pack(uint8_t *data) = 0;
 };
 
+/**
+ * PIN code, sent unencrypted right after connecting (UUID 0001)
+ */
+struct PinData : public WritableData {
+  uint32_t pin_code{0};
+
+  PinData(Xxtea *xxtea) : WritableData(4, xxtea) {}
+
+  void pack(uint8_t *data) override {
+    data[0] = (this->pin_code >> 0) & 0xFF;
+    data[1] = (this->pin_code >> 8) & 0xFF;
+    data[2] = (this->pin_code >> 16) & 0xFF;
+    data[3] = (this->pin_code >> 24) & 0xFF;
+  }
+};
+
 /**
  * Handles Temperature and Target Setpoint (UUID 0005)
  */
@@ -31,20 +49,20 @@ struct TemperatureData : public WritableData {
   float room_temperature{0.0f};
   float target_temperature{0.0f};
 
-  // Constructor for decoding data read from the device
-  TemperatureData(std::shared_ptr<Xxtea> &xxtea, uint8_t *raw_data, uint16_t value_len) : WritableData(8, xxtea) {
-    if (value_len < 8) return;
+  TemperatureData(Xxtea *xxtea) : WritableData(8, xxtea) {}
+
+  // Decodes data read from the device, returns false if it is too short
+  bool decode(uint8_t *raw_data, uint16_t value_len) {
+    if (value_len < 8) return false;
     uint8_t decrypted[8];
-    xxtea->decrypt(raw_data, 8, decrypted);
-    
+    this->xxtea->decrypt(raw_data, 8, decrypted);
+
     // Danfoss uses 0.5°C units (value / 2)
     this->room_temperature = (float)decrypted[0] / 2.0f;
     this->target_temperature = (float)decrypted[1] / 2.0f;
+    return true;
   }
 
-  // Constructor for creating a command to send to the device
-  TemperatureData(std::shared_ptr<Xxtea> &xxtea) : WritableData(8, xxtea) {}
-
   void pack(uint8_t *data) override {
     uint8_t plain[8] = {0};
     plain[0] = (uint8_t)(this->room_temperature * 2);
@@ -54,37 +72,222 @@ struct TemperatureData : public WritableData {
   }
 };
 
+// Parts of SettingsData which can be changed
+static const uint8_t SETTINGS_MODE = 1 << 0;
+static const uint8_t SETTINGS_LIMITS = 1 << 1;
+
 /**
  * Handles Device Settings and Min/Max limits (UUID 0003)
+ * The decrypted value is kept as read, writes only change the edited fields on top of it.
  */
 struct SettingsData : public WritableData {
   float temperature_min{5.0f};
   float temperature_max{30.0f};
   climate::ClimateMode device_mode{climate::CLIMATE_MODE_HEAT};
 
-  SettingsData(std::shared_ptr<Xxtea> &xxtea, uint8_t *raw_data, uint16_t value_len) : WritableData(16, xxtea) {
-    if (value_len < 16) return;
-    uint8_t decrypted[16];
-    xxtea->decrypt(raw_data, 16, decrypted);
+  uint8_t image[16]{};
+  bool known{false};
+  // Fields changed locally and not acknowledged by the valve yet (SETTINGS_* bits)
+  uint8_t pending_mask{0};
+  climate::ClimateMode pending_mode{climate::CLIMATE_MODE_HEAT};
+  float pending_min{5.0f};
+  float pending_max{30.0f};
+
+  SettingsData(Xxtea *xxtea) : WritableData(16, xxtea) {}
+
+  bool decode(uint8_t *raw_data, uint16_t value_len) {
+    if (value_len < 16) return false;
+    this->xxtea->decrypt(raw_data, 16, this->image);
+    this->known = true;
+    this->decode_image_();
+    return true;
+  }
+
+  // Drops pending fields which already match the valve, returns true if any are left to write
+  bool has_changes() {
+    if ((this->pending_mask & SETTINGS_MODE) && this->pending_mode == this->device_mode) {
+      this->pending_mask &= ~SETTINGS_MODE;
+    }
+    if ((this->pending_mask & SETTINGS_LIMITS) && this->pending_min == this->temperature_min &&
+        this->pending_max == this->temperature_max) {
+      this->pending_mask &= ~SETTINGS_LIMITS;
+    }
+    return this->pending_mask != 0;
+  }
+
+  // Called once a write was acknowledged, the pending fields are now what the valve has
+  void commit() {
+    this->apply_pending_(this->image);
+    this->pending_mask = 0;
+    this->decode_image_();
+  }
+
+  void pack(uint8_t *data) override {
+    uint8_t plain[16];
+    memcpy(plain, this->image, 16);
+    this->apply_pending_(plain);
+    this->xxtea->encrypt(plain, 16, data);
+  }
+
+ protected:
+  void decode_image_() {
+    this->temperature_min = (float)this->image[3] / 2.0f;
+    this->temperature_max = (float)this->image[4] / 2.0f;
 
-    this->temperature_min = (float)decrypted[3] / 2.0f;
-    this->temperature_max = (float)decrypted[4] / 2.0f;
-    
     // Mode mapping: 0 = Manual (Heat), 1 = At Home (Auto), 2 = Vacation (Off/Eco)
-    uint8_t mode = decrypted[0];
+    uint8_t mode = this->image[0];
     if (mode == 0) this->device_mode = climate::CLIMATE_MODE_HEAT;
     else if (mode == 1) this->device_mode = climate::CLIMATE_MODE_AUTO;
     else this->device_mode = climate::CLIMATE_MODE_OFF;
   }
 
-  SettingsData(std::shared_ptr<Xxtea> &xxtea) : WritableData(16, xxtea) {}
+  void apply_pending_(uint8_t *plain) const {
+    if (this->pending_mask & SETTINGS_MODE) {
+      plain[0] = (this->pending_mode == climate::CLIMATE_MODE_AUTO) ? 1 : 0;
+    }
+    if (this->pending_mask & SETTINGS_LIMITS) {
+      plain[3] = (uint8_t)(this->pending_min * 2);
+      plain[4] = (uint8_t)(this->pending_max * 2);
+    }
+  }
+};
+
+/**
+ * Valve clock (UUID 0008): local time and its offset from UTC, in seconds
+ */
+struct CurrentTimeData : public WritableData {
+  uint32_t time_local{0};
+  int32_t time_offset{0};
+
+  CurrentTimeData(Xxtea *xxtea) : WritableData(8, xxtea) {}
+
+  bool decode(uint8_t *raw_data, uint16_t value_len) {
+    if (value_len < 8) return false;
+    uint8_t decrypted[8];
+    this->xxtea->decrypt(raw_data, 8, decrypted);
+    this->time_local = decrypted[0] | (decrypted[1] << 8) | (decrypted[2] << 16) | ((uint32_t) decrypted[3] << 24);
+    this->time_offset = (int32_t) (decrypted[4] | (decrypted[5] << 8) | (decrypted[6] << 16) |
+                                   ((uint32_t) decrypted[7] << 24));
+    return true;
+  }
+
+  void pack(uint8_t *data) override {
+    uint8_t plain[8];
+    for (uint8_t i = 0; i < 4; i++) {
+      plain[i] = (this->time_local >> (i * 8)) & 0xFF;
+      plain[4 + i] = ((uint32_t) this->time_offset >> (i * 8)) & 0xFF;
+    }
+    this->xxtea->encrypt(plain, 8, data);
+  }
+};
+
+// Weekly schedule: 7 days of up to 3 heating periods, spread over 3 characteristics (UUIDs 000d-000f)
+static const uint8_t SCHEDULE_DAYS = 7;
+static const uint8_t SCHEDULE_PERIODS = 3;
+static const uint8_t SCHEDULE_CHUNKS = 3;
+static const uint8_t SCHEDULE_DAYS_PER_CHUNK = 3;
+static const uint8_t SCHEDULE_CHUNK_LENGTH = 20;
+static_assert(SCHEDULE_DAYS_PER_CHUNK * SCHEDULE_PERIODS * 2 <= SCHEDULE_CHUNK_LENGTH,
+              "schedule days of a chunk don't fit in its value");
+// Periods are stored as half hours since midnight, 48 is the end of the day
+static const uint8_t SCHEDULE_END_OF_DAY = 48;
+
+/**
+ * Heating period of a schedule day, disabled when start == end
+ */
+struct SchedulePeriod {
+  uint8_t start{0};
+  uint8_t end{0};
+
+  bool operator==(const SchedulePeriod &other) const { return start == other.start && end == other.end; }
+  bool operator!=(const SchedulePeriod &other) const { return !(*this == other); }
+};
+
+struct ScheduleDay {
+  SchedulePeriod periods[SCHEDULE_PERIODS];
+
+  bool operator==(const ScheduleDay &other) const {
+    for (uint8_t i = 0; i < SCHEDULE_PERIODS; i++) {
+      if (periods[i] != other.periods[i]) return false;
+    }
+    return true;
+  }
+  bool operator!=(const ScheduleDay &other) const { return !(*this == other); }
+};
+
+/**
+ * One schedule characteristic, holding up to 3 days (Monday first).
+ * The decrypted value is kept as read, so a write only changes the days which were
+ * edited and leaves any bytes we don't know about untouched.
+ */
+struct ScheduleData : public WritableData {
+  uint8_t chunk;
+  uint8_t image[SCHEDULE_CHUNK_LENGTH]{};
+  bool known{false};
+  // Days edited locally and not acknowledged by the valve yet, bit per day of this chunk
+  uint8_t pending_mask{0};
+  ScheduleDay pending[SCHEDULE_DAYS_PER_CHUNK];
+
+  // A chunk past the last one is kept as SCHEDULE_CHUNKS, which holds no days
+  ScheduleData(uint8_t chunk, Xxtea *xxtea)
+      : WritableData(SCHEDULE_CHUNK_LENGTH, xxtea), chunk(chunk < SCHEDULE_CHUNKS ? chunk : SCHEDULE_CHUNKS) {}
+
+  uint8_t day_count() const {
+    int first = this->chunk * SCHEDULE_DAYS_PER_CHUNK;
+    if (first >= SCHEDULE_DAYS) return 0;
+    int left = SCHEDULE_DAYS - first;
+    return left < SCHEDULE_DAYS_PER_CHUNK ? left : SCHEDULE_DAYS_PER_CHUNK;
+  }
+
+  bool decode(uint8_t *raw_data, uint16_t value_len) {
+    if (value_len < SCHEDULE_CHUNK_LENGTH) return false;
+    this->xxtea->decrypt(raw_data, SCHEDULE_CHUNK_LENGTH, this->image);
+    this->known = true;
+    return true;
+  }
+
+  // Day i of this chunk, as last read from (or acknowledged by) the valve
+  ScheduleDay day(uint8_t i) const {
+    ScheduleDay day;
+    const uint8_t *src = this->image + i * SCHEDULE_PERIODS * 2;
+    for (uint8_t p = 0; p < SCHEDULE_PERIODS; p++) {
+      day.periods[p].start = src[p * 2];
+      day.periods[p].end = src[p * 2 + 1];
+    }
+    return day;
+  }
+
+  // Drops pending days which already match the valve, returns true if any are left to write
+  bool has_changes() {
+    for (uint8_t i = 0; i < this->day_count() && i < SCHEDULE_DAYS_PER_CHUNK; i++) {
+      if ((this->pending_mask & (1 << i)) && this->pending[i] == this->day(i)) this->pending_mask &= ~(1 << i);
+    }
+    return this->pending_mask != 0;
+  }
+
+  // Called once a write was acknowledged, the pending days are now what the valve has
+  void commit() {
+    this->apply_pending_(this->image);
+    this->pending_mask = 0;
+  }
 
   void pack(uint8_t *data) override {
-    uint8_t plain[16] = {0};
-    plain[0] = (this->device_mode == climate::CLIMATE_MODE_AUTO) ? 1 : 0;
-    plain[3] = (uint8_t)(this->temperature_min * 2);
-    plain[4] = (uint8_t)(this->temperature_max * 2);
-    this->xxtea->encrypt(plain, 16, data);
+    uint8_t plain[SCHEDULE_CHUNK_LENGTH];
+    memcpy(plain, this->image, SCHEDULE_CHUNK_LENGTH);
+    this->apply_pending_(plain);
+    this->xxtea->encrypt(plain, SCHEDULE_CHUNK_LENGTH, data);
+  }
+
+ protected:
+  void apply_pending_(uint8_t *plain) const {
+    for (uint8_t i = 0; i < this->day_count() && i < SCHEDULE_DAYS_PER_CHUNK; i++) {
+      if ((this->pending_mask & (1 << i)) == 0) continue;
+      uint8_t *dst = plain + i * SCHEDULE_PERIODS * 2;
+      for (uint8_t p = 0; p < SCHEDULE_PERIODS; p++) {
+        dst[p * 2] = this->pending[i].periods[p].start;
+        dst[p * 2 + 1] = this->pending[i].periods[p].end;
+      }
+    }
   }
 };
 
@@ -92,23 +295,27 @@ struct SettingsData : public WritableData {
  * Decodes Error codes from the valve (UUID 0009)
  */
 struct ErrorsData : public DeviceData {
+  Xxtea *xxtea;
   bool E9_VALVE_DOES_NOT_CLOSE{false};
   bool E10_INVALID_TIME{false};
   bool E14_LOW_BATTERY{false};
   bool E15_VERY_LOW_BATTERY{false};
 
-  ErrorsData(std::shared_ptr<Xxtea> &xxtea, uint8_t *raw_data, uint16_t value_len) {
-    if (value_len < 8) return;
+  ErrorsData(Xxtea *xxtea) : xxtea(xxtea) {}
+
+  bool decode(uint8_t *raw_data, uint16_t value_len) {
+    if (value_len < 8) return false;
     uint8_t decrypted[8];
-    xxtea->decrypt(raw_data, 8, decrypted);
+    this->xxtea->decrypt(raw_data, 8, decrypted);
 
     // Bitwise error mapping for Danfoss Eco
     this->E9_VALVE_DOES_NOT_CLOSE = (decrypted[0] & 0x01);
     this->E10_INVALID_TIME = (decrypted[0] & 0x02);
     this->E14_LOW_BATTERY = (decrypted[1] & 0x01);
     this->E15_VERY_LOW_BATTERY = (decrypted[1] & 0x02);
+    return true;
   }
 };
 
 } // namespace danfoss_eco
-} // namespace esphome
\ No newline at end of file
+} // namespace esphome
@@ -0,0 +1,74 @@
+#include "gatt_trace.h"
+#include "esphome/core/hal.h"
+#include "esphome/core/log.h"
+#include "helpers.h"
+#include <algorithm>
+#include <cstring>
+
+namespace esphome {
+namespace danfoss_eco {
+
+static const char *const TAG = "danfoss_eco.trace";
+
+static_assert(sizeof(GattTraceRecord) == 32, "GattTraceRecord should stay 32 bytes");
+
+GattTrace::GattTrace(uint16_t capacity) : records_(new GattTraceRecord[capacity]), capacity_(capacity) {}
+
+void GattTrace::record(esp_gattc_cb_event_t event, esp_ble_gattc_cb_param_t *param) {
+  GattTraceRecord &rec = this->records_[this->head_];
+  memset(&rec, 0, sizeof(rec));
+  rec.timestamp = millis();
+  rec.event = event;
+
+  const uint8_t *value = nullptr;
+  switch (event) {
+    case ESP_GATTC_READ_CHAR_EVT:
+    case ESP_GATTC_READ_MULTIPLE_EVT:
+      rec.status = param->read.status;
+      rec.handle = param->read.handle;
+      rec.value_len = param->read.value_len;
+      value = param->read.value;
+      break;
+    case ESP_GATTC_WRITE_CHAR_EVT:
+      rec.status = param->write.status;
+      rec.handle = param->write.handle;
+      break;
+    case ESP_GATTC_OPEN_EVT:
+      rec.status = param->open.status;
+      rec.handle = param->open.mtu;
+      break;
+    case ESP_GATTC_CFG_MTU_EVT:
+      rec.status = param->cfg_mtu.status;
+      rec.handle = param->cfg_mtu.mtu;
+      break;
+    case ESP_GATTC_SEARCH_CMPL_EVT:
+      rec.status = param->search_cmpl.status;
+      break;
+    case ESP_GATTC_DISCONNECT_EVT:
+      rec.handle = param->disconnect.reason;
+      break;
+    default:
+      break;
+  }
+  if (value != nullptr) {
+    memcpy(rec.payload, value, std::min<uint16_t>(rec.value_len, GattTraceRecord::TRACE_PAYLOAD_SIZE));
+  }
+
+  this->head_ = (this->head_ + 1) % this->capacity_;
+  if (this->size_ < this->capacity_) this->size_++;
+  this->recorded_++;
+}
+
+void GattTrace::dump() const {
+  ESP_LOGI(TAG, "GATT trace: %u of %" PRIu32 " events, oldest first", this->size_, this->recorded_);
+  uint16_t first = (this->head_ + this->capacity_ - this->size_) % this->capacity_;
+  char hex[sizeof(GattTraceRecord) * 2 + 1];
+  for (uint16_t i = 0; i < this->size_; i++) {
+    const auto &rec = this->records_[(first + i) % this->capacity_];
+    encode_hex(reinterpret_cast<const uint8_t *>(&rec), sizeof(rec), hex);
+    ESP_LOGI(TAG, "TRACE %u %s", i, hex);
+  }
+}
+
+} // namespace danfoss_eco
+} // namespace esphome
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <esp_gattc_api.h>
+#include <cstdint>
+#include <memory>
+
+namespace esphome {
+namespace danfoss_eco {
+
+/**
+ * One traced GATT client event, 32 bytes.
+ *
+ * value_len is the length the stack reported, only the first TRACE_PAYLOAD_SIZE bytes are kept
+ * (enough for every Danfoss characteristic, Read Multiple responses may be cut short).
+ */
+struct GattTraceRecord {
+  static const uint8_t TRACE_PAYLOAD_SIZE = 22;
+
+  uint32_t timestamp;  // millis()
+  uint16_t handle;     // attribute handle, the MTU for OPEN/CFG_MTU, the reason for DISCONNECT
+  uint16_t value_len;
+  uint8_t event;       // esp_gattc_cb_event_t
+  uint8_t status;      // esp_gatt_status_t
+  uint8_t payload[TRACE_PAYLOAD_SIZE];
+};
+
+/**
+ * Ring buffer of the last GATT client events of one valve, records are overwritten oldest first.
+ *
+ * Dumped over the log as one hex line per record ("TRACE <index> <32 bytes>", fields little-endian
+ * as laid out in GattTraceRecord), which is easy to grep out of a serial capture.
+ */
+class GattTrace {
+ public:
+  explicit GattTrace(uint16_t capacity);
+
+  void record(esp_gattc_cb_event_t event, esp_ble_gattc_cb_param_t *param);
+  void dump() const;
+
+  uint16_t capacity() const { return this->capacity_; }
+  uint16_t size() const { return this->size_; }
+  uint32_t recorded() const { return this->recorded_; }
+
+ protected:
+  std::unique_ptr<GattTraceRecord[]> records_;
+  uint16_t capacity_;
+  uint16_t head_{0};  // next record to write
+  uint16_t size_{0};
+  uint32_t recorded_{0};
+};
+
+} // namespace danfoss_eco
+} // namespace esphome
@@ -1,6 +1,5 @@
 #include "helpers.h"
 #include "esphome/core/log.h"
-#include <cstdio>
 #include <cstring>
 
 namespace esphome {
@@ -22,8 +21,10 @@ void parse_hex_str(const char *data, size_t str_len, uint8_t *buff) {
 }
 
 void encode_hex(const uint8_t *data, size_t len, char *buff) {
+  static const char HEX_DIGITS[] = "0123456789abcdef";
   for (size_t i = 0; i < len; i++) {
-    sprintf(buff + i * 2, "%02x", data[i]);
+    buff[i * 2] = HEX_DIGITS[data[i] >> 4];
+    buff[i * 2 + 1] = HEX_DIGITS[data[i] & 0x0F];
   }
   buff[len * 2] = '\0';
 }
@@ -0,0 +1,68 @@
+#include "latency.h"
+
+namespace esphome {
+namespace danfoss_eco {
+
+// Upper bounds (ms) of the histogram buckets, the last one catches everything above
+static const uint32_t BUCKET_BOUNDS[LatencyHistogram::BUCKET_COUNT] = {
+    10, 25, 50, 100, 250, 500, 1000, 2500, 5000, 10000, 30000, UINT32_MAX,
+};
+
+const char *latency_stage_to_string(LatencyStage stage) {
+  switch (stage) {
+    case LatencyStage::CONNECT:
+      return "Connect";
+    case LatencyStage::DISCOVERY:
+      return "Discovery";
+    case LatencyStage::QUEUE_WAIT:
+      return "Queue Wait";
+    case LatencyStage::ROUND_TRIP:
+      return "Round Trip";
+    case LatencyStage::WRITE_ACK:
+      return "Write Ack";
+    default:
+      return "Unknown";
+  }
+}
+
+void LatencyHistogram::record(uint32_t ms) {
+  uint8_t bucket = 0;
+  while (ms > BUCKET_BOUNDS[bucket]) bucket++;
+
+  if (this->buckets_[bucket] == UINT16_MAX) {
+    // Halve all buckets rather than saturate, keeping the shape and favouring recent samples
+    for (auto &count : this->buckets_) count /= 2;
+  }
+  this->buckets_[bucket]++;
+  this->count_++;
+  if (ms > this->max_) this->max_ = ms;
+}
+
+uint32_t LatencyHistogram::percentile(uint8_t percent) const {
+  uint32_t total = 0;
+  for (auto count : this->buckets_) total += count;
+  if (total == 0) return 0;
+
+  // Rank of the sample at this percentile, rounded up
+  uint32_t rank = (total * percent + 99) / 100;
+  uint32_t seen = 0;
+  for (uint8_t i = 0; i < BUCKET_COUNT; i++) {
+    seen += this->buckets_[i];
+    if (seen >= rank) return BUCKET_BOUNDS[i] < this->max_ ? BUCKET_BOUNDS[i] : this->max_;
+  }
+  return this->max_;
+}
+
+uint32_t LatencyHistogram::value(LatencyStat stat) const {
+  switch (stat) {
+    case LatencyStat::P50:
+      return this->percentile(50);
+    case LatencyStat::P95:
+      return this->percentile(95);
+    default:
+      return this->max_;
+  }
+}
+
+} // namespace danfoss_eco
+} // namespace esphome
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstdint>
+
+namespace esphome {
+namespace danfoss_eco {
+
+enum class LatencyStage : uint8_t {
+  CONNECT,     // connection attempt until the link is ESTABLISHED
+  DISCOVERY,   // ESP_GATTC_OPEN_EVT until ESP_GATTC_SEARCH_CMPL_EVT
+  QUEUE_WAIT,  // command queued until first sent
+  ROUND_TRIP,  // GATT request until its response
+  WRITE_ACK,   // user write queued until acknowledged by the valve, reconnects included
+};
+static const uint8_t LATENCY_STAGE_COUNT = 5;
+
+enum class LatencyStat : uint8_t { P50, P95, MAX };
+static const uint8_t LATENCY_STAT_COUNT = 3;
+
+const char *latency_stage_to_string(LatencyStage stage);
+
+/**
+ * Fixed-bucket histogram of durations in ms, 32 bytes and no allocations.
+ *
+ * Percentiles are resolved to the upper bound of the bucket they fall into (capped
+ * at the largest sample seen), which is plenty to tell a 50 ms round trip from a 2 s one.
+ */
+class LatencyHistogram {
+ public:
+  static const uint8_t BUCKET_COUNT = 12;
+
+  void record(uint32_t ms);
+  uint32_t percentile(uint8_t percent) const;
+  uint32_t value(LatencyStat stat) const;
+  uint32_t max() const { return this->max_; }
+  uint32_t count() const { return this->count_; }
+
+ protected:
+  uint16_t buckets_[BUCKET_COUNT]{};
+  uint32_t count_{0};
+  uint32_t max_{0};
+};
+
+} // namespace danfoss_eco
+} // namespace esphome
@@ -1,12 +1,18 @@
 #include "my_component.h"
 #include "device.h"
 #include "esphome/core/log.h"
+#include <esp_heap_caps.h>
 
 namespace esphome {
 namespace danfoss_eco {
 
 static const char *const TAG = "danfoss_eco.climate";
 
+// Give up a pooled slot if the session did not finish in time (e.g. valve out of range)
+static const uint32_t POOL_SESSION_TIMEOUT_MS = 30000;
+// Keep the link open briefly after the queue drains, so a follow-up command can reuse it
+static const uint32_t POOL_LINGER_MS = 500;
+
 void MyComponent::setup() {
   ESP_LOGD(TAG, "MyComponent::setup() starting");
   
@@ -15,6 +21,7 @@ void MyComponent::setup() {
   
   this->device_ = std::make_shared<Device>(this, this->xxtea_instance_);
   ESP_LOGD(TAG, "Device instance created");
+  this->device_->set_read_multiple(this->read_multiple_);
   
   // Apply pending secret key if it was set before device was created
   if (!this->pending_secret_key_.empty()) {
@@ -23,33 +30,196 @@ void MyComponent::setup() {
   } else {
     ESP_LOGW(TAG, "WARNING: No pending secret key found!");
   }
+  if (!this->pending_pin_code_.empty()) this->device_->set_pin_code(this->pending_pin_code_);
   
   // Device is now fully constructed, safe to call methods
   ESP_LOGD(TAG, "Calling device_->setup()");
   this->device_->setup();
+  this->device_->restore_snapshot();
   ESP_LOGD(TAG, "MyComponent::setup() complete");
 }
 
+void MyComponent::on_safe_shutdown() {
+  if (this->device_) {
+    this->device_->save_snapshot(true);
+  }
+}
+
 void MyComponent::loop() {
   this->device_->loop();
   
-  // Call update every 60 seconds
   uint32_t now = millis();
-  if (now - this->last_update_ > 60000) {
-    this->device_->update();
-    this->last_update_ = now;
+  if (this->pool_ != nullptr) {
+    this->loop_pooled_(now);
+    return;
+  }
+
+  if (this->device_->is_ready() && this->poll_due_(now)) {
+    this->poll_(now);
   }
 }
 
+bool MyComponent::poll_due_(uint32_t now) const {
+  // Stagger only holds back the first poll, later ones are compared against last_poll_ (wraps cleanly)
+  if (!this->polled_ && (int32_t) (now - this->first_poll_at_) < 0) return false;
+  return !this->polled_ || now - this->last_poll_ >= this->polling_.interval();
+}
+
+void MyComponent::poll_(uint32_t now) {
+  this->device_->update();
+  this->polled_ = true;
+  this->last_poll_ = now;
+  ESP_LOGD(TAG, "[%s] Next poll in %" PRIu32 " s", this->get_name().c_str(), this->polling_.interval() / 1000);
+  ESP_LOGV(TAG, "Heap: %zu bytes free, largest block %zu bytes", heap_caps_get_free_size(MALLOC_CAP_8BIT),
+           heap_caps_get_largest_free_block(MALLOC_CAP_8BIT));
+}
+
+void MyComponent::loop_pooled_(uint32_t now) {
+  if (!this->pool_->holds_slot(this)) {
+    // BLEClient enables itself during setup, so the link is parked on the first loop instead
+    if (!this->pool_client_disabled_) {
+      this->parent()->set_enabled(false);
+      this->pool_client_disabled_ = true;
+    }
+    if (this->poll_due_(now) || !this->device_->is_idle()) {
+      if (this->in_range_()) {
+        this->pool_->request(this);
+      } else if (this->poll_due_(now)) {
+        // Don't spend a slot on a connect timeout, pending writes wait until the valve is heard again
+        ESP_LOGD(TAG, "[%s] Not heard by the scanner recently, skipping poll", this->get_name().c_str());
+        this->polled_ = true;
+        this->last_poll_ = now;
+      }
+    }
+    return;
+  }
+
+  if (now - this->session_start_ > POOL_SESSION_TIMEOUT_MS) {
+    ESP_LOGW(TAG, "[%s] Session timed out, releasing connection slot", this->get_name().c_str());
+    // Don't keep queueing for an unreachable valve, try again on the next poll
+    this->polled_ = true;
+    this->last_poll_ = now;
+    this->release_slot_(now);
+    return;
+  }
+
+  if (!this->device_->is_ready()) return;
+
+  if (this->update_pending_) {
+    this->poll_(now);
+    this->update_pending_ = false;
+    this->idle_ = false;
+    return;
+  }
+
+  if (!this->device_->is_idle()) {
+    this->idle_ = false;
+    return;
+  }
+  if (!this->idle_) {
+    this->idle_ = true;
+    this->idle_since_ = now;
+  } else if (now - this->idle_since_ >= POOL_LINGER_MS) {
+    this->release_slot_(now);
+  }
+}
+
+void MyComponent::release_slot_(uint32_t now) {
+  this->parent()->set_enabled(false);
+  this->update_pending_ = false;
+  this->idle_ = false;
+  this->pool_->release(this);
+}
+
+bool MyComponent::in_range_() const {
+#ifdef USE_DANFOSS_ECO_SCANNER
+  if (this->scanner_ != nullptr) {
+    return this->scanner_->is_reachable(this->parent_->get_address(), this->scanner_max_age_, this->scanner_min_rssi_);
+  }
+#endif
+  return true;
+}
+
+void MyComponent::on_slot_granted(uint32_t wait_ms) {
+  this->slot_wait_last_ = wait_ms;
+  if (wait_ms > this->slot_wait_max_) this->slot_wait_max_ = wait_ms;
+  ESP_LOGD(TAG, "[%s] Connection slot granted after waiting %" PRIu32 " ms", this->get_name().c_str(), wait_ms);
+  if (this->slot_wait_ != nullptr) {
+    this->slot_wait_->publish_state(wait_ms);
+  }
+
+  this->session_start_ = millis();
+  this->update_pending_ = true;
+  this->idle_ = false;
+  this->parent()->set_enabled(true);
+}
+
+void MyComponent::set_connection_slots(uint8_t slots) {
+  this->pool_ = ConnectionPool::instance();
+  this->pool_->set_max_slots(slots);
+  this->first_poll_at_ = millis() + this->pool_->register_component(this);
+}
+
 void MyComponent::update() {
   this->device_->update();
 }
 
 void MyComponent::dump_config() {
   LOG_CLIMATE("", "Danfoss Eco", this);
+  ESP_LOGCONFIG(TAG, "  Read Multiple: %s", YESNO(this->read_multiple_));
+  ESP_LOGCONFIG(TAG, "  Update Interval: %" PRIu32 " s (min %" PRIu32 " s)", this->polling_.max_interval() / 1000,
+                this->polling_.min_interval() / 1000);
+  if (this->gatt_trace_) {
+    ESP_LOGCONFIG(TAG, "  GATT Trace: last %u events", this->gatt_trace_->capacity());
+  }
+  ESP_LOGCONFIG(TAG, "  Publish Heartbeat: %" PRIu32 " s", this->publish_heartbeat_ / 1000);
+  if (this->pool_ != nullptr) {
+    ESP_LOGCONFIG(TAG, "  Connection Slots: %u", this->pool_->max_slots());
+    ESP_LOGCONFIG(TAG, "  Slot Wait: last %" PRIu32 " ms, max %" PRIu32 " ms", this->slot_wait_last_, this->slot_wait_max_);
+  }
+#ifdef USE_TIME
+  if (this->time_ != nullptr) {
+    ESP_LOGCONFIG(TAG, "  Time Sync: drift above %" PRIu32 " s, or on E10", this->time_sync_threshold_ / 1000);
+  }
+#endif
+#ifdef USE_DANFOSS_ECO_SCANNER
+  if (this->scanner_ != nullptr) {
+    ESP_LOGCONFIG(TAG, "  Scanner: heard within %" PRIu32 " s, RSSI >= %d dBm", this->scanner_max_age_ / 1000,
+                  this->scanner_min_rssi_);
+  }
+#endif
+  LOG_SENSOR("  ", "Slot Wait", this->slot_wait_);
+  LOG_SENSOR("  ", "Coalesced Commands", this->coalesced_commands_);
+  LOG_BINARY_SENSOR("  ", "Stale", this->stale_);
+  LOG_SENSOR("  ", "Skipped Decrypts", this->skipped_decrypts_);
+  LOG_SENSOR("  ", "Suppressed Publishes", this->suppressed_publishes_);
+  if (this->connection_params_.enabled) {
+    const auto &params = this->connection_params_;
+    ESP_LOGCONFIG(TAG, "  Connection Interval: %.2f ms while busy, %.2f ms with latency %u after %" PRIu32 " ms idle",
+                  params.fast_interval * 1.25f, params.slow_interval * 1.25f, params.slow_latency, params.idle_delay);
+  }
+  ESP_LOGCONFIG(TAG, "  Energy Model: %.2f mA connected, %.2f mAs per connection, %.2f mAs per operation",
+                this->energy_model_.connected_current, this->energy_model_.connection_charge,
+                this->energy_model_.operation_charge);
+  for (auto *sens : this->airtime_sensors_) {
+    LOG_SENSOR("  ", "Airtime", sens);
+  }
+  for (auto &stage_sensors : this->latency_sensors_) {
+    for (auto *sens : stage_sensors) {
+      LOG_SENSOR("  ", "Latency", sens);
+    }
+  }
+  if (this->device_) {
+    this->device_->dump_config();
+  }
+  ESP_LOGCONFIG(TAG, "  Heap: %zu bytes free, largest block %zu bytes", heap_caps_get_free_size(MALLOC_CAP_8BIT),
+                heap_caps_get_largest_free_block(MALLOC_CAP_8BIT));
 }
 
 void MyComponent::control(const climate::ClimateCall &call) {
+  if (call.get_target_temperature().has_value()) {
+    this->polling_.on_target_temperature(*call.get_target_temperature());
+  }
   this->device_->control(call);
 }
 
@@ -66,10 +236,45 @@ climate::ClimateTraits MyComponent::traits() {
 }
 
 void MyComponent::gattc_event_handler(esp_gattc_cb_event_t event, esp_gatt_if_t gattc_if, esp_ble_gattc_cb_param_t *param) {
+  if (this->gatt_trace_) this->gatt_trace_->record(event, param);
   this->device_->gattc_event_handler(event, gattc_if, param);
 }
 
+void MyComponent::gap_event_handler(esp_gap_ble_cb_event_t event, esp_ble_gap_cb_param_t *param) {
+  this->device_->gap_event_handler(event, param);
+}
+
+void MyComponent::set_gatt_trace(uint16_t records) {
+  if (records == 0) {
+    this->gatt_trace_.reset();
+  } else {
+    this->gatt_trace_.reset(new GattTrace(records));
+  }
+}
+
+void MyComponent::dump_gatt_trace() {
+  if (!this->gatt_trace_) {
+    ESP_LOGW(TAG, "GATT trace is not enabled, set gatt_trace to the number of events to keep");
+    return;
+  }
+  this->gatt_trace_->dump();
+}
+
+void MyComponent::set_schedule_day(uint8_t day, const ScheduleDay &schedule) {
+  if (this->device_) {
+    this->device_->set_schedule_day(day, schedule);
+  }
+}
+
+void MyComponent::set_temperature_limits(float min, float max) {
+  if (this->device_) {
+    this->device_->set_temperature_limits(min, max);
+  }
+}
+
 void MyComponent::set_pin_code(const std::string &pin) {
+  // Set by the generated code before setup() has created the device
+  this->pending_pin_code_ = pin;
   if (this->device_) {
     this->device_->set_pin_code(pin);
   }
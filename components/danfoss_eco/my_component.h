@@ -1,23 +1,51 @@
 #pragma once
 
 #include "esphome/core/component.h"
+#include "esphome/core/defines.h"
 #include "esphome/components/climate/climate.h"
 #include "esphome/components/ble_client/ble_client.h"
 #include "esphome/components/sensor/sensor.h"
 #include "esphome/components/binary_sensor/binary_sensor.h"
 #include "xxtea.h"
+#include "connection_pool.h"
+#include "polling_policy.h"
+#include "latency.h"
+#include "airtime.h"
+#include "gatt_trace.h"
+#include "device_data.h"
+#ifdef USE_DANFOSS_ECO_SCANNER
+#include "esphome/components/danfoss_eco_scanner/device_scanner.h"
+#endif
+#ifdef USE_TIME
+#include "esphome/components/time/real_time_clock.h"
+#endif
+#include <memory>
+#include <string>
 
 namespace esphome {
 namespace danfoss_eco {
 
 class Device; // Forward declaration
 
+/**
+ * Connection parameters requested from the valve: fast while commands are queued, slow once idle
+ */
+struct ConnectionParams {
+  bool enabled{true};
+  uint16_t fast_interval{12};   // 1.25 ms units (15 ms)
+  uint16_t slow_interval{400};  // 1.25 ms units (500 ms)
+  uint16_t slow_latency{4};     // connection events the valve may skip while slow
+  uint16_t timeout{600};        // supervision timeout, 10 ms units (6 s)
+  uint32_t idle_delay{1000};    // ms after the queue drained before switching to slow
+};
+
 class MyComponent : public climate::Climate, public esphome::ble_client::BLEClientNode, public Component {
  public:
   void setup() override;
   void loop() override;
   void update();
   void dump_config() override;
+  void on_safe_shutdown() override;
 
   // Climate overrides
   void control(const climate::ClimateCall &call) override;
@@ -31,31 +59,145 @@ class MyComponent : public climate::Climate, public esphome::ble_client::BLEClie
   void set_battery_level(sensor::Sensor *s) { battery_level_ = s; }
   void set_temperature(sensor::Sensor *s) { temperature_ = s; }
   void set_problems(binary_sensor::BinarySensor *s) { problems_ = s; }
+  void set_slot_wait(sensor::Sensor *s) { slot_wait_ = s; }
+  void set_coalesced_commands(sensor::Sensor *s) { coalesced_commands_ = s; }
+  void set_stale(binary_sensor::BinarySensor *s) { stale_ = s; }
+  void set_skipped_decrypts(sensor::Sensor *s) { skipped_decrypts_ = s; }
+  void set_suppressed_publishes(sensor::Sensor *s) { suppressed_publishes_ = s; }
   
   sensor::Sensor *battery_level() { return battery_level_; }
   sensor::Sensor *temperature() { return temperature_; }
   binary_sensor::BinarySensor *problems() { return problems_; }
+  sensor::Sensor *coalesced_commands() { return coalesced_commands_; }
+  binary_sensor::BinarySensor *stale() { return stale_; }
+  sensor::Sensor *skipped_decrypts() { return skipped_decrypts_; }
+  sensor::Sensor *suppressed_publishes() { return suppressed_publishes_; }
+
+  // Latency diagnostics, one optional sensor per stage and statistic
+  void set_latency_sensor(LatencyStage stage, LatencyStat stat, sensor::Sensor *s) {
+    latency_sensors_[static_cast<uint8_t>(stage)][static_cast<uint8_t>(stat)] = s;
+  }
+  sensor::Sensor *latency_sensor(LatencyStage stage, LatencyStat stat) {
+    return latency_sensors_[static_cast<uint8_t>(stage)][static_cast<uint8_t>(stat)];
+  }
+
+  // Airtime diagnostics and the model used to estimate battery drain from them
+  void set_airtime_sensor(AirtimeStat stat, sensor::Sensor *s) { airtime_sensors_[static_cast<uint8_t>(stat)] = s; }
+  sensor::Sensor *airtime_sensor(AirtimeStat stat) { return airtime_sensors_[static_cast<uint8_t>(stat)]; }
+  void set_energy_model(float connected_current, float connection_charge, float operation_charge) {
+    energy_model_.connected_current = connected_current;
+    energy_model_.connection_charge = connection_charge;
+    energy_model_.operation_charge = operation_charge;
+  }
+  const EnergyModel &energy_model() const { return energy_model_; }
+
+  void set_connection_params(bool enabled, uint16_t fast_interval, uint16_t slow_interval, uint16_t slow_latency,
+                             uint16_t timeout, uint32_t idle_delay) {
+    connection_params_ = {enabled, fast_interval, slow_interval, slow_latency, timeout, idle_delay};
+  }
+  const ConnectionParams &connection_params() const { return connection_params_; }
+
+  void set_read_multiple(bool read_multiple) { read_multiple_ = read_multiple; }
+
+  // Polling (update_interval is the upper bound, min_update_interval the lower one)
+  void set_update_interval(uint32_t interval) { polling_.set_max_interval(interval); }
+  void set_min_update_interval(uint32_t interval) { polling_.set_min_interval(interval); }
+  PollingPolicy &polling() { return polling_; }
+
+  // Unchanged values are published again after this long, so consumers can tell the valve is alive
+  void set_publish_heartbeat(uint32_t heartbeat) { publish_heartbeat_ = heartbeat; }
+  uint32_t publish_heartbeat() const { return publish_heartbeat_; }
+
+  // Weekly schedule, day 0 is Monday (see danfoss_eco.set_schedule_day)
+  void set_schedule_day(uint8_t day, const ScheduleDay &schedule);
+  // Min/max temperature the valve accepts (see danfoss_eco.set_temperature_limits)
+  void set_temperature_limits(float min, float max);
 
   void set_pin_code(const std::string &pin);
   void set_secret_key(const std::string &key);
   void set_secret_key(uint8_t *key, bool persist);
 
+  // Connection Pool (shared BLE links)
+  void set_connection_slots(uint8_t slots);
+  void on_slot_granted(uint32_t wait_ms);
+
+#ifdef USE_TIME
+  // Valve clock is set from this time source, during sessions which are open anyway
+  void set_time(time::RealTimeClock *time) { time_ = time; }
+  void set_time_sync_threshold(uint32_t threshold) { time_sync_threshold_ = threshold; }
+  time::RealTimeClock *time_source() { return time_; }
+  uint32_t time_sync_threshold() const { return time_sync_threshold_; }
+#endif
+
+#ifdef USE_DANFOSS_ECO_SCANNER
+  // Pooled valves are only connected if the scanner heard them recently, with usable signal
+  void set_scanner(danfoss_eco_scanner::DanfossEcoScanner *scanner) { scanner_ = scanner; }
+  void set_scanner_max_age(uint32_t max_age) { scanner_max_age_ = max_age; }
+  void set_scanner_min_rssi(int min_rssi) { scanner_min_rssi_ = min_rssi; }
+#endif
+
+  // Keeps the last `records` GATT client events for danfoss_eco.dump_gatt_trace, 0 disables tracing
+  void set_gatt_trace(uint16_t records);
+  void dump_gatt_trace();
+
   // GATT Event Bridge
   void gattc_event_handler(esp_gattc_cb_event_t event, esp_gatt_if_t gattc_if, esp_ble_gattc_cb_param_t *param) override;
+  void gap_event_handler(esp_gap_ble_cb_event_t event, esp_ble_gap_cb_param_t *param) override;
 
  protected:
   std::shared_ptr<Device> device_;
   std::shared_ptr<Xxtea> xxtea_instance_;
+  std::unique_ptr<GattTrace> gatt_trace_;
 
   sensor::Sensor *battery_level_{nullptr};
   sensor::Sensor *temperature_{nullptr};
   binary_sensor::BinarySensor *problems_{nullptr};
+  sensor::Sensor *slot_wait_{nullptr};
+  sensor::Sensor *coalesced_commands_{nullptr};
+  binary_sensor::BinarySensor *stale_{nullptr};
+  sensor::Sensor *skipped_decrypts_{nullptr};
+  sensor::Sensor *suppressed_publishes_{nullptr};
+  sensor::Sensor *latency_sensors_[LATENCY_STAGE_COUNT][LATENCY_STAT_COUNT]{};
+  sensor::Sensor *airtime_sensors_[AIRTIME_STAT_COUNT]{};
+  EnergyModel energy_model_;
+  ConnectionParams connection_params_;
 
   float visual_min_temp_{5.0f};
   float visual_max_temp_{35.0f};
   
-  uint32_t last_update_{0};
+  bool poll_due_(uint32_t now) const;
+  void poll_(uint32_t now);
+  void loop_pooled_(uint32_t now);
+  void release_slot_(uint32_t now);
+  bool in_range_() const;
+
+  bool read_multiple_{true};
+  PollingPolicy polling_;
+  bool polled_{false};
+  uint32_t last_poll_{0};
+  uint32_t first_poll_at_{0};
+  uint32_t publish_heartbeat_{900000};
+
+  ConnectionPool *pool_{nullptr};
+  bool pool_client_disabled_{false};
+  bool update_pending_{false};
+  bool idle_{false};
+  uint32_t session_start_{0};
+  uint32_t idle_since_{0};
+  uint32_t slot_wait_last_{0};
+  uint32_t slot_wait_max_{0};
   std::string pending_secret_key_;
+  std::string pending_pin_code_;
+
+#ifdef USE_TIME
+  time::RealTimeClock *time_{nullptr};
+  uint32_t time_sync_threshold_{60000};
+#endif
+#ifdef USE_DANFOSS_ECO_SCANNER
+  danfoss_eco_scanner::DanfossEcoScanner *scanner_{nullptr};
+  uint32_t scanner_max_age_{120000};
+  int scanner_min_rssi_{-90};
+#endif
 };
 
 } // namespace danfoss_eco
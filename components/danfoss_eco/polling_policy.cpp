@@ -0,0 +1,62 @@
+#include "polling_policy.h"
+#include <cmath>
+
+namespace esphome {
+namespace danfoss_eco {
+
+// Temperature change rate (°C/min) and setpoint distance (°C) at which the valve is polled at min interval
+static const float FAST_RATE = 0.1f;
+static const float FAST_ERROR = 2.0f;
+// Weight of the newest sample in the smoothed change rate
+static const float RATE_SMOOTHING = 0.5f;
+// Below this battery level, polling is gradually slowed down towards max interval
+static const uint8_t LOW_BATTERY_LEVEL = 25;
+
+void PollingPolicy::set_max_interval(uint32_t interval_ms) {
+  this->max_interval_ = interval_ms;
+  this->recalculate_();
+}
+
+void PollingPolicy::set_min_interval(uint32_t interval_ms) {
+  this->min_interval_ = interval_ms;
+  this->recalculate_();
+}
+
+void PollingPolicy::on_temperature(float room_temperature, float target_temperature, uint32_t now) {
+  if (this->has_sample_ && now != this->sample_at_) {
+    float minutes = (now - this->sample_at_) / 60000.0f;
+    float rate = std::fabs(room_temperature - this->room_temperature_) / minutes;
+    this->rate_ = RATE_SMOOTHING * rate + (1.0f - RATE_SMOOTHING) * this->rate_;
+  }
+  this->has_sample_ = true;
+  this->room_temperature_ = room_temperature;
+  this->sample_at_ = now;
+  this->error_ = std::fabs(target_temperature - room_temperature);
+  this->recalculate_();
+}
+
+void PollingPolicy::on_target_temperature(float target_temperature) {
+  if (!this->has_sample_) return;
+  this->error_ = std::fabs(target_temperature - this->room_temperature_);
+  this->recalculate_();
+}
+
+void PollingPolicy::on_battery_level(uint8_t level) {
+  this->battery_level_ = level;
+  this->recalculate_();
+}
+
+void PollingPolicy::recalculate_() {
+  uint32_t min_interval = this->min_interval_ < this->max_interval_ ? this->min_interval_ : this->max_interval_;
+
+  // 0 = steady state, 1 = poll as fast as allowed
+  float urgency = std::fmax(std::fmin(this->rate_ / FAST_RATE, 1.0f), std::fmin(this->error_ / FAST_ERROR, 1.0f));
+  if (this->battery_level_ < LOW_BATTERY_LEVEL) {
+    urgency *= (float) this->battery_level_ / LOW_BATTERY_LEVEL;
+  }
+
+  this->interval_ = this->max_interval_ - (uint32_t) (urgency * (this->max_interval_ - min_interval));
+}
+
+} // namespace danfoss_eco
+} // namespace esphome
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstdint>
+
+namespace esphome {
+namespace danfoss_eco {
+
+/**
+ * Picks the next poll interval for a valve, between min and max (update_interval).
+ *
+ * Polls fast while the room temperature is moving or far from the setpoint
+ * (e.g. heating towards a new setpoint), slow once the room has settled,
+ * and backs off towards max when the valve battery is low.
+ */
+class PollingPolicy {
+ public:
+  void set_max_interval(uint32_t interval_ms);
+  void set_min_interval(uint32_t interval_ms);
+  uint32_t max_interval() const { return this->max_interval_; }
+  uint32_t min_interval() const { return this->min_interval_; }
+
+  void on_temperature(float room_temperature, float target_temperature, uint32_t now);
+  void on_target_temperature(float target_temperature);
+  void on_battery_level(uint8_t level);
+
+  uint32_t interval() const { return this->interval_; }
+
+ protected:
+  void recalculate_();
+
+  uint32_t max_interval_{60000};
+  uint32_t min_interval_{60000};
+  uint32_t interval_{60000};
+
+  bool has_sample_{false};
+  float room_temperature_{0.0f};
+  uint32_t sample_at_{0};
+  float rate_{0.0f};   // smoothed |dT/dt|, °C per minute
+  float error_{0.0f};  // |target - room|, °C
+  uint8_t battery_level_{100};
+};
+
+} // namespace danfoss_eco
+} // namespace esphome
@@ -1,4 +1,5 @@
 #include "properties.h"
+#include "esphome/core/hal.h"
 #include "esphome/core/log.h"
 #include "helpers.h"
 
@@ -7,10 +8,53 @@ namespace danfoss_eco {
 
 static const char *const TAG = "danfoss_eco.prop";
 
+struct CharacteristicInfo {
+  bool danfoss;  // UUID on the Danfoss base (1002xxxx-2749-0001-0000-00805f9b042f), else a 16-bit UUID
+  uint16_t service;
+  uint16_t characteristic;
+};
+
+// Indexed by CharacteristicId. Constant data only, so nothing is built at static init time
+static const CharacteristicInfo CHARACTERISTICS[] = {
+    {true, 0x0000, 0x0001},   // PIN
+    {true, 0x0000, 0x0003},   // SETTINGS
+    {true, 0x0000, 0x0005},   // TEMPERATURE
+    {true, 0x0000, 0x0008},   // CURRENT_TIME
+    {true, 0x0000, 0x0009},   // ERRORS
+    {true, 0x0000, 0x000b},   // SECRET_KEY
+    {true, 0x0000, 0x000d},   // SCHEDULE_1
+    {true, 0x0000, 0x000e},   // SCHEDULE_2
+    {true, 0x0000, 0x000f},   // SCHEDULE_3
+    {false, 0x180F, 0x2A19},  // BATTERY
+};
+
+// Danfoss base UUID in esp_bt_uuid_t (little-endian) byte order, bytes 12-13 hold the variable part
+static const uint8_t DANFOSS_UUID_BASE[16] = {0x2f, 0x04, 0x9b, 0x5f, 0x80, 0x00, 0x00, 0x00,
+                                              0x01, 0x00, 0x49, 0x27, 0x00, 0x00, 0x02, 0x10};
+
+static esp32_ble_tracker::ESPBTUUID make_uuid(bool danfoss, uint16_t value) {
+  if (!danfoss) return esp32_ble_tracker::ESPBTUUID::from_uint16(value);
+  uint8_t raw[16];
+  memcpy(raw, DANFOSS_UUID_BASE, sizeof(raw));
+  raw[12] = value & 0xFF;
+  raw[13] = value >> 8;
+  return esp32_ble_tracker::ESPBTUUID::from_raw(raw);
+}
+
+esp32_ble_tracker::ESPBTUUID service_uuid(CharacteristicId id) {
+  auto &info = CHARACTERISTICS[static_cast<uint8_t>(id)];
+  return make_uuid(info.danfoss, info.service);
+}
+
+esp32_ble_tracker::ESPBTUUID characteristic_uuid(CharacteristicId id) {
+  auto &info = CHARACTERISTICS[static_cast<uint8_t>(id)];
+  return make_uuid(info.danfoss, info.characteristic);
+}
+
 bool DeviceProperty::init_handle(BLEClient *client) {
-  auto chr = client->get_characteristic(this->service_uuid, this->characteristic_uuid);
+  auto chr = client->get_characteristic(service_uuid(this->id_), characteristic_uuid(this->id_));
   if (chr == nullptr) {
-    ESP_LOGW(TAG, "Characteristic %s not found", this->characteristic_uuid.to_string().c_str());
+    ESP_LOGW(TAG, "Characteristic %s not found", characteristic_uuid(this->id_).to_string().c_str());
     return false;
   }
   this->handle = chr->handle;
@@ -23,6 +67,49 @@ bool DeviceProperty::read_request(BLEClient *client) {
   return status == ESP_OK;
 }
 
+void DeviceProperty::forget_value() {
+  this->last_value_len_ = 0;
+  this->published_ = false;
+}
+
+bool DeviceProperty::value_changed_(const uint8_t *value, uint16_t value_len) {
+  if (value_len > sizeof(this->last_value_)) {
+    this->last_value_len_ = 0;
+    return true;
+  }
+  if (this->last_value_len_ != 0 && value_len == this->last_value_len_ &&
+      memcmp(value, this->last_value_, value_len) == 0) {
+    this->decrypts_skipped++;
+    return false;
+  }
+  memcpy(this->last_value_, value, value_len);
+  this->last_value_len_ = value_len;
+  return true;
+}
+
+bool DeviceProperty::publish_due_(bool changed) {
+  uint32_t now = millis();
+  if (changed || !this->published_ || now - this->published_at_ >= this->component_->publish_heartbeat()) {
+    this->published_ = true;
+    this->published_at_ = now;
+    return true;
+  }
+  this->publishes_suppressed++;
+  return false;
+}
+
+bool DeviceProperty::read_multiple_request(BLEClient *client, DeviceProperty *const *properties, uint8_t count) {
+  if (count == 0 || count > ESP_GATT_MAX_READ_MULTI_HANDLES) return false;
+  esp_gattc_multi_t multi{};
+  multi.num_attr = count;
+  for (uint8_t i = 0; i < count; i++) {
+    multi.handles[i] = properties[i]->handle;
+  }
+  auto status = esp_ble_gattc_read_multiple(client->get_gattc_if(), client->get_conn_id(), &multi,
+                                            ESP_GATT_AUTH_REQ_NONE);
+  return status == ESP_OK;
+}
+
 bool WritableProperty::write_request(BLEClient *client, uint8_t *data, uint16_t data_len) {
   auto status = esp_ble_gattc_write_char(client->get_gattc_if(), client->get_conn_id(), 
                                          this->handle, data_len, data, 
@@ -31,25 +118,51 @@ bool WritableProperty::write_request(BLEClient *client, uint8_t *data, uint16_t
 }
 
 bool WritableProperty::write_request(BLEClient *client) {
-  if (this->data == nullptr) return false;
-  auto *writable_data = static_cast<WritableData *>(this->data.get());
+  auto *writable_data = this->writable_data();
   uint8_t buff[20] = {0}; // Danfoss payloads are typically 8 or 16 bytes
   writable_data->pack(buff);
   return this->write_request(client, buff, writable_data->length);
 }
 
-void BatteryProperty::update_state(uint8_t *value, uint16_t value_len) {
-  if (value_len > 0 && this->component_->battery_level() != nullptr) {
-    this->component_->battery_level()->publish_state(value[0]);
+bool BatteryProperty::update_state(uint8_t *value, uint16_t value_len) {
+  if (value_len == 0) return false;
+  bool changed = value[0] != this->level;
+  this->level = value[0];
+  if (this->publish_due_(changed)) this->publish();
+  return true;
+}
+
+void BatteryProperty::publish() {
+  this->component_->polling().on_battery_level(this->level);
+  if (this->component_->battery_level() != nullptr) {
+    this->component_->battery_level()->publish_state(this->level);
   }
 }
 
-void TemperatureProperty::update_state(uint8_t *value, uint16_t value_len) {
-  auto t_data = std::make_unique<TemperatureData>(this->xxtea_, value, value_len);
-  
+bool TemperatureProperty::update_state(uint8_t *value, uint16_t value_len) {
+  bool changed = false;
+  if (this->value_changed_(value, value_len)) {
+    float room = this->data.room_temperature;
+    float target = this->data.target_temperature;
+    if (!this->data.decode(value, value_len)) {
+      ESP_LOGW(TAG, "Temperature value too short (%u bytes)", value_len);
+      this->last_value_len_ = 0;
+      return false;
+    }
+    changed = room != this->data.room_temperature || target != this->data.target_temperature;
+  }
+  // Unchanged samples still count, they let the polling policy see the temperature settle
+  this->component_->polling().on_temperature(this->data.room_temperature, this->data.target_temperature, millis());
+  if (this->publish_due_(changed)) this->publish();
+  return true;
+}
+
+void TemperatureProperty::publish() {
+  auto *t_data = &this->data;
+
   this->component_->current_temperature = t_data->room_temperature;
   this->component_->target_temperature = t_data->target_temperature;
-  
+
   // Update Action state
   if (this->component_->current_temperature < this->component_->target_temperature) {
     this->component_->action = climate::CLIMATE_ACTION_HEATING;
@@ -61,28 +174,98 @@ void TemperatureProperty::update_state(uint8_t *value, uint16_t value_len) {
     this->component_->temperature()->publish_state(t_data->room_temperature);
   }
 
-  this->data = std::move(t_data);
   this->component_->publish_state();
 }
 
-void SettingsProperty::update_state(uint8_t *value, uint16_t value_len) {
-  auto s_data = std::make_unique<SettingsData>(this->xxtea_, value, value_len);
-  
-  this->component_->mode = s_data->device_mode;
-  this->component_->set_visual_min_temperature_override(s_data->temperature_min);
-  this->component_->set_visual_max_temperature_override(s_data->temperature_max);
-  
-  this->data = std::move(s_data);
+bool SettingsProperty::update_state(uint8_t *value, uint16_t value_len) {
+  if (!this->value_changed_(value, value_len)) {
+    this->read_at = millis();
+    if (this->publish_due_(false)) this->publish();
+    return true;
+  }
+  uint8_t previous[sizeof(this->data.image)];
+  memcpy(previous, this->data.image, sizeof(previous));
+  bool was_known = this->data.known;
+  if (!this->data.decode(value, value_len)) {
+    ESP_LOGW(TAG, "Settings value too short (%u bytes)", value_len);
+    this->last_value_len_ = 0;
+    return false;
+  }
+  this->read_at = millis();
+  bool changed = !was_known || memcmp(previous, this->data.image, sizeof(previous)) != 0;
+  if (was_known && changed && this->data.pending_mask != 0) {
+    // Changed on the valve itself (buttons or app): pending fields are applied on top of the new value
+    ESP_LOGD(TAG, "Settings changed on the valve, merging pending changes");
+  }
+  if (this->publish_due_(changed)) this->publish();
+  return true;
+}
+
+void SettingsProperty::publish() {
+  auto *s_data = &this->data;
+  bool mode_pending = s_data->pending_mask & SETTINGS_MODE;
+  bool limits_pending = s_data->pending_mask & SETTINGS_LIMITS;
+
+  // Values which are still being written are shown as requested, not as last read
+  this->component_->mode = mode_pending ? s_data->pending_mode : s_data->device_mode;
+  this->component_->set_visual_min_temperature_override(limits_pending ? s_data->pending_min : s_data->temperature_min);
+  this->component_->set_visual_max_temperature_override(limits_pending ? s_data->pending_max : s_data->temperature_max);
+
   this->component_->publish_state();
 }
 
-void ErrorsProperty::update_state(uint8_t *value, uint16_t value_len) {
-  auto e_data = std::make_unique<ErrorsData>(this->xxtea_, value, value_len);
+bool ErrorsProperty::update_state(uint8_t *value, uint16_t value_len) {
+  bool changed = false;
+  if (this->value_changed_(value, value_len)) {
+    bool had_problem = this->has_problem();
+    if (!this->data.decode(value, value_len)) {
+      ESP_LOGW(TAG, "Errors value too short (%u bytes)", value_len);
+      this->last_value_len_ = 0;
+      return false;
+    }
+    changed = had_problem != this->has_problem();
+  }
+  if (this->publish_due_(changed)) this->publish();
+  return true;
+}
+
+bool ErrorsProperty::has_problem() const {
+  return this->data.E9_VALVE_DOES_NOT_CLOSE || this->data.E14_LOW_BATTERY || this->data.E15_VERY_LOW_BATTERY;
+}
+
+void ErrorsProperty::publish() {
   if (this->component_->problems() != nullptr) {
-    bool has_problem = e_data->E9_VALVE_DOES_NOT_CLOSE || e_data->E14_LOW_BATTERY || e_data->E15_VERY_LOW_BATTERY;
-    this->component_->problems()->publish_state(has_problem);
+    this->component_->problems()->publish_state(this->has_problem());
+  }
+}
+
+bool CurrentTimeProperty::update_state(uint8_t *value, uint16_t value_len) {
+  if (!this->data.decode(value, value_len)) {
+    ESP_LOGW(TAG, "Current time value too short (%u bytes)", value_len);
+    return false;
   }
-  this->data = std::move(e_data);
+  ESP_LOGD(TAG, "Valve clock: %" PRIu32 " (UTC offset %" PRId32 " s)", this->data.time_local, this->data.time_offset);
+  return true;
+}
+
+bool ScheduleProperty::update_state(uint8_t *value, uint16_t value_len) {
+  if (!this->value_changed_(value, value_len)) {
+    this->read_at = millis();
+    return true;
+  }
+  if (!this->data.decode(value, value_len)) {
+    ESP_LOGW(TAG, "Schedule value too short (%u bytes)", value_len);
+    this->last_value_len_ = 0;
+    return false;
+  }
+  this->read_at = millis();
+  for (uint8_t i = 0; i < this->data.day_count(); i++) {
+    auto day = this->data.day(i);
+    ESP_LOGD(TAG, "Schedule day %u: %u-%u, %u-%u, %u-%u (half hours)", this->data.chunk * SCHEDULE_DAYS_PER_CHUNK + i,
+             day.periods[0].start, day.periods[0].end, day.periods[1].start, day.periods[1].end,
+             day.periods[2].start, day.periods[2].end);
+  }
+  return true;
 }
 
 bool SecretKeyProperty::init_handle(BLEClient *client) {
@@ -91,10 +274,10 @@ bool SecretKeyProperty::init_handle(BLEClient *client) {
   return DeviceProperty::init_handle(client);
 }
 
-void SecretKeyProperty::update_state(uint8_t *value, uint16_t value_len) {
-  if (value_len == 16) {
-    this->component_->set_secret_key(value, true);
-  }
+bool SecretKeyProperty::update_state(uint8_t *value, uint16_t value_len) {
+  if (value_len != 16) return false;
+  this->component_->set_secret_key(value, true);
+  return true;
 }
 
 } // namespace danfoss_eco
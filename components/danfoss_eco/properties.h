@@ -5,91 +5,190 @@
 #include "my_component.h"
 #include "device_data.h"
 #include <memory>
+#include <vector>
 
 namespace esphome {
 namespace danfoss_eco {
 
 using BLEClient = ble_client::BLEClient;
 
-// 1. UUIDs must be defined BEFORE the classes that use them
-static auto SERVICE_SETTINGS = esp32_ble_tracker::ESPBTUUID::from_raw("10020000-2749-0001-0000-00805f9b042f");
-static auto CHARACTERISTIC_PIN = esp32_ble_tracker::ESPBTUUID::from_raw("10020001-2749-0001-0000-00805f9b042f");
-static auto CHARACTERISTIC_SETTINGS = esp32_ble_tracker::ESPBTUUID::from_raw("10020003-2749-0001-0000-00805f9b042f");
-static auto CHARACTERISTIC_TEMPERATURE = esp32_ble_tracker::ESPBTUUID::from_raw("10020005-2749-0001-0000-00805f9b042f");
-static auto CHARACTERISTIC_ERRORS = esp32_ble_tracker::ESPBTUUID::from_raw("10020009-2749-0001-0000-00805f9b042f");
-static auto CHARACTERISTIC_SECRET_KEY = esp32_ble_tracker::ESPBTUUID::from_raw("1002000b-2749-0001-0000-00805f9b042f");
+// Characteristics used by the component, UUIDs are kept in a constant table (see properties.cpp)
+enum class CharacteristicId : uint8_t {
+  PIN,
+  SETTINGS,
+  TEMPERATURE,
+  CURRENT_TIME,
+  ERRORS,
+  SECRET_KEY,
+  SCHEDULE_1,
+  SCHEDULE_2,
+  SCHEDULE_3,
+  BATTERY,
+};
 
-static auto SERVICE_BATTERY = esp32_ble_tracker::ESPBTUUID::from_uint32(0x180F);
-static auto CHARACTERISTIC_BATTERY = esp32_ble_tracker::ESPBTUUID::from_uint32(0x2A19);
+esp32_ble_tracker::ESPBTUUID service_uuid(CharacteristicId id);
+esp32_ble_tracker::ESPBTUUID characteristic_uuid(CharacteristicId id);
 
 const uint16_t INVALID_HANDLE_VAL = 0xFFFF;
 enum PropertyType { TYPE_READ_ONLY, TYPE_WRITABLE };
 
 class DeviceProperty {
  public:
-  std::unique_ptr<DeviceData> data{nullptr};
   uint16_t handle{INVALID_HANDLE_VAL};
   PropertyType prop_type{TYPE_READ_ONLY};
 
-  DeviceProperty(MyComponent *component, std::shared_ptr<Xxtea> xxtea, 
-                 esp32_ble_tracker::ESPBTUUID s_uuid, esp32_ble_tracker::ESPBTUUID c_uuid) 
-      : component_(component), xxtea_(xxtea), service_uuid(s_uuid), characteristic_uuid(c_uuid) {}
+  DeviceProperty(MyComponent *component, std::shared_ptr<Xxtea> xxtea, CharacteristicId id)
+      : component_(component), xxtea_(xxtea), id_(id) {}
+
+  CharacteristicId characteristic() const { return this->id_; }
 
-  virtual void update_state(uint8_t *value, uint16_t value_len){};
+  // Decodes a value read from the valve, false if it was rejected (nothing was updated)
+  virtual bool update_state(uint8_t *value, uint16_t value_len) { return false; }
   virtual bool init_handle(BLEClient *client);
+  // Fixed size of the characteristic value, 0 if unknown
+  virtual uint16_t value_length() const { return 0; }
   bool read_request(BLEClient *client);
+  // Drops the last raw value and published state, so the next read is decoded and published
+  void forget_value();
+
+  uint32_t decrypts_skipped{0};
+  uint32_t publishes_suppressed{0};
+
+  // Reads several characteristics in one ATT Read Multiple request
+  static bool read_multiple_request(BLEClient *client, DeviceProperty *const *properties, uint8_t count);
 
  protected:
   MyComponent *component_;
   std::shared_ptr<Xxtea> xxtea_;
-  esp32_ble_tracker::ESPBTUUID service_uuid;
-  esp32_ble_tracker::ESPBTUUID characteristic_uuid;
+  CharacteristicId id_;
+
+  // Remembers the raw (encrypted) value, false if it is the same as last read and needs no decoding
+  bool value_changed_(const uint8_t *value, uint16_t value_len);
+  // True if a read should be published: the decoded state changed, or the heartbeat is due
+  bool publish_due_(bool changed);
+
+  uint8_t last_value_[20];
+  uint8_t last_value_len_{0};
+  bool published_{false};
+  uint32_t published_at_{0};
 };
 
 class WritableProperty : public DeviceProperty {
  public:
-  WritableProperty(MyComponent *component, std::shared_ptr<Xxtea> xxtea, 
-                   esp32_ble_tracker::ESPBTUUID s_uuid, esp32_ble_tracker::ESPBTUUID c_uuid) 
-      : DeviceProperty(component, xxtea, s_uuid, c_uuid) {
+  WritableProperty(MyComponent *component, std::shared_ptr<Xxtea> xxtea, CharacteristicId id)
+      : DeviceProperty(component, xxtea, id) {
       this->prop_type = TYPE_WRITABLE;
   }
   bool write_request(BLEClient *client);
   bool write_request(BLEClient *client, uint8_t *data, uint16_t data_len);
+  // Length of the value sent by write_request()
+  uint16_t payload_length() { return this->writable_data()->length; }
+
+ protected:
+  // Payload packed by write_request(), owned by the concrete property
+  virtual WritableData *writable_data() = 0;
+};
+
+class PinProperty : public WritableProperty {
+ public:
+  PinData data;
+
+  PinProperty(MyComponent *component, std::shared_ptr<Xxtea> xxtea)
+      : WritableProperty(component, xxtea, CharacteristicId::PIN), data(xxtea.get()) {}
+
+ protected:
+  WritableData *writable_data() override { return &this->data; }
 };
 
 class BatteryProperty : public DeviceProperty {
  public:
+  uint8_t level{0};
+
   BatteryProperty(MyComponent *component, std::shared_ptr<Xxtea> xxtea) 
-      : DeviceProperty(component, xxtea, SERVICE_BATTERY, CHARACTERISTIC_BATTERY) {}
-  void update_state(uint8_t *value, uint16_t value_len) override;
+      : DeviceProperty(component, xxtea, CharacteristicId::BATTERY) {}
+  bool update_state(uint8_t *value, uint16_t value_len) override;
+  // Publishes the current level, also used for values restored after boot
+  void publish();
+  uint16_t value_length() const override { return 1; }
 };
 
 class TemperatureProperty : public WritableProperty {
  public:
+  TemperatureData data;
+  // Kept apart from data, so a read landing before the write is sent doesn't undo the new setpoint
+  TemperatureData setpoint;
+
   TemperatureProperty(MyComponent *component, std::shared_ptr<Xxtea> xxtea) 
-      : WritableProperty(component, xxtea, SERVICE_SETTINGS, CHARACTERISTIC_TEMPERATURE) {}
-  void update_state(uint8_t *value, uint16_t value_len) override;
+      : WritableProperty(component, xxtea, CharacteristicId::TEMPERATURE), data(xxtea.get()),
+        setpoint(xxtea.get()) {}
+  bool update_state(uint8_t *value, uint16_t value_len) override;
+  void publish();
+  uint16_t value_length() const override { return 8; }
+
+ protected:
+  WritableData *writable_data() override { return &this->setpoint; }
 };
 
 class SettingsProperty : public WritableProperty {
  public:
+  SettingsData data;
+  uint32_t read_at{0};
+
   SettingsProperty(MyComponent *component, std::shared_ptr<Xxtea> xxtea) 
-      : WritableProperty(component, xxtea, SERVICE_SETTINGS, CHARACTERISTIC_SETTINGS) {}
-  void update_state(uint8_t *value, uint16_t value_len) override;
+      : WritableProperty(component, xxtea, CharacteristicId::SETTINGS), data(xxtea.get()) {}
+  bool update_state(uint8_t *value, uint16_t value_len) override;
+  void publish();
+  uint16_t value_length() const override { return 16; }
+
+ protected:
+  WritableData *writable_data() override { return &this->data; }
 };
 
 class ErrorsProperty : public DeviceProperty {
  public:
+  ErrorsData data;
+
   ErrorsProperty(MyComponent *component, std::shared_ptr<Xxtea> xxtea) 
-      : DeviceProperty(component, xxtea, SERVICE_SETTINGS, CHARACTERISTIC_ERRORS) {}
-  void update_state(uint8_t *value, uint16_t value_len) override;
+      : DeviceProperty(component, xxtea, CharacteristicId::ERRORS), data(xxtea.get()) {}
+  bool update_state(uint8_t *value, uint16_t value_len) override;
+  void publish();
+  // Errors reported through the problems binary sensor
+  bool has_problem() const;
+  uint16_t value_length() const override { return 8; }
+};
+
+class CurrentTimeProperty : public WritableProperty {
+ public:
+  CurrentTimeData data;
+
+  CurrentTimeProperty(MyComponent *component, std::shared_ptr<Xxtea> xxtea)
+      : WritableProperty(component, xxtea, CharacteristicId::CURRENT_TIME), data(xxtea.get()) {}
+  bool update_state(uint8_t *value, uint16_t value_len) override;
+  uint16_t value_length() const override { return 8; }
+
+ protected:
+  WritableData *writable_data() override { return &this->data; }
+};
+
+class ScheduleProperty : public WritableProperty {
+ public:
+  ScheduleData data;
+  uint32_t read_at{0};
+
+  ScheduleProperty(MyComponent *component, std::shared_ptr<Xxtea> xxtea, uint8_t chunk)
+      : WritableProperty(component, xxtea, static_cast<CharacteristicId>(static_cast<uint8_t>(CharacteristicId::SCHEDULE_1) + chunk)), data(chunk, xxtea.get()) {}
+  bool update_state(uint8_t *value, uint16_t value_len) override;
+  uint16_t value_length() const override { return SCHEDULE_CHUNK_LENGTH; }
+
+ protected:
+  WritableData *writable_data() override { return &this->data; }
 };
 
 class SecretKeyProperty : public DeviceProperty {
  public:
   SecretKeyProperty(MyComponent *component, std::shared_ptr<Xxtea> xxtea) 
-      : DeviceProperty(component, xxtea, SERVICE_SETTINGS, CHARACTERISTIC_SECRET_KEY) {}
-  void update_state(uint8_t *value, uint16_t value_len) override;
+      : DeviceProperty(component, xxtea, CharacteristicId::SECRET_KEY) {}
+  bool update_state(uint8_t *value, uint16_t value_len) override;
   bool init_handle(BLEClient *client) override;
 };
 
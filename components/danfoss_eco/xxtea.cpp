@@ -3,6 +3,7 @@
 
 #define MX (((z >> 5) ^ (y << 2)) + ((y >> 3) ^ (z << 4))) ^ ((sum ^ y) + (k[(p & 3) ^ e] ^ z))
 
+// Generic fallback for payload sizes without a dedicated kernel
 void Xxtea::btea(uint32_t *v, int32_t n, uint32_t const k[4])
 {
     uint32_t y, z, sum;
@@ -47,6 +48,48 @@ void Xxtea::btea(uint32_t *v, int32_t n, uint32_t const k[4])
     }
 }
 
+void Xxtea::crypt_words(uint32_t *v, int32_t n, uint32_t const k[4])
+{
+    switch (n)
+    {
+    case 2:
+        encrypt_block<2>(v, k);
+        break;
+    case 4:
+        encrypt_block<4>(v, k);
+        break;
+    case -2:
+        decrypt_block<2>(v, k);
+        break;
+    case -4:
+        decrypt_block<4>(v, k);
+        break;
+    default:
+        btea(v, n, k);
+        break;
+    }
+}
+
+int Xxtea::decrypt_lanes(uint32_t *v, const uint32_t *k, size_t words, size_t lanes)
+{
+    if (v == NULL || k == NULL)
+    {
+        return XXTEA_STATUS_PARAMETER_ERROR;
+    }
+
+    switch (words)
+    {
+    case 2:
+        decrypt_lanes<2>(v, k, lanes);
+        return XXTEA_STATUS_SUCCESS;
+    case 4:
+        decrypt_lanes<4>(v, k, lanes);
+        return XXTEA_STATUS_SUCCESS;
+    default:
+        return XXTEA_STATUS_SIZE_ERROR;
+    }
+}
+
 int Xxtea::set_key(uint8_t *key, size_t len)
 {
     this->status_ = XXTEA_STATUS_GENERAL_ERROR;
@@ -73,7 +116,7 @@ int Xxtea::set_key(uint8_t *key, size_t len)
     return this->status_;
 }
 
-int Xxtea::encrypt(uint8_t *data, size_t len, uint8_t *buf, size_t *maxlen)
+int Xxtea::encrypt(uint8_t *data, size_t len, uint8_t *buf, size_t *maxlen) const
 {
     if (data == NULL || len <= 0 || len > MAX_XXTEA_DATA8 ||
         buf == NULL || maxlen == NULL || *maxlen <= 0 || *maxlen < len)
@@ -88,49 +131,32 @@ int Xxtea::encrypt(uint8_t *data, size_t len, uint8_t *buf, size_t *maxlen)
         return XXTEA_STATUS_SIZE_ERROR;
     }
 
-    memset((void *)this->xxtea_data, 0, MAX_XXTEA_DATA8);
-    memcpy((void *)this->xxtea_data, (const void *)data, len);
+    // Work on an aligned copy, only padding needs zeroing
+    uint32_t words[MAX_XXTEA_DATA32];
+    words[l - 1] = 0;
+    memcpy((void *)words, (const void *)data, len);
 
-    btea(this->xxtea_data, l, this->xxtea_key);
+    crypt_words(words, l, this->xxtea_key);
 
-    memcpy((void *)buf, (const void *)this->xxtea_data, (l * 4));
+    memcpy((void *)buf, (const void *)words, (l * 4));
 
     *maxlen = l * 4;
 
     return XXTEA_STATUS_SUCCESS;
 }
 
-int Xxtea::encrypt(uint8_t *data, size_t len, uint8_t *buf)
+int Xxtea::encrypt(uint8_t *data, size_t len, uint8_t *buf) const
 {
     size_t maxlen = MAX_XXTEA_DATA8;
     return encrypt(data, len, buf, &maxlen);
 }
 
-int Xxtea::decrypt(uint8_t *data, size_t len)
+int Xxtea::decrypt(uint8_t *data, size_t len) const
 {
-    if (data == NULL || len <= 0 || (len % 4) != 0)
-    {
-        return XXTEA_STATUS_PARAMETER_ERROR;
-    }
-    
-    if (len > MAX_XXTEA_DATA8)
-    {
-        return XXTEA_STATUS_SIZE_ERROR;
-    }
-    
-    memset((void *)this->xxtea_data, 0, MAX_XXTEA_DATA8);
-    memcpy((void *)this->xxtea_data, (const void *)data, len);
-    
-    int32_t l = -((int32_t)len / 4);
-    
-    btea(this->xxtea_data, l, this->xxtea_key);
-    
-    memcpy((void *)data, (const void *)this->xxtea_data, len);
-    
-    return XXTEA_STATUS_SUCCESS;
+    return decrypt(data, len, data);
 }
 
-int Xxtea::decrypt(uint8_t *data, size_t len, uint8_t *buf)
+int Xxtea::decrypt(uint8_t *data, size_t len, uint8_t *buf) const
 {
     if (data == NULL || len <= 0 || (len % 4) != 0 || buf == NULL)
     {
@@ -142,14 +168,14 @@ int Xxtea::decrypt(uint8_t *data, size_t len, uint8_t *buf)
         return XXTEA_STATUS_SIZE_ERROR;
     }
     
-    memset((void *)this->xxtea_data, 0, MAX_XXTEA_DATA8);
-    memcpy((void *)this->xxtea_data, (const void *)data, len);
+    uint32_t words[MAX_XXTEA_DATA32];
+    memcpy((void *)words, (const void *)data, len);
     
     int32_t l = -((int32_t)len / 4);
     
-    btea(this->xxtea_data, l, this->xxtea_key);
+    crypt_words(words, l, this->xxtea_key);
     
-    memcpy((void *)buf, (const void *)this->xxtea_data, len);
+    memcpy((void *)buf, (const void *)words, len);
     
     return XXTEA_STATUS_SUCCESS;
 }
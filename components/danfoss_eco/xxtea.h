@@ -16,6 +16,11 @@
 
 #define XXTEA_DELTA 0x9E3779B9
 
+/**
+ * XXTEA cipher. Apart from the key, no state is kept between calls, so a keyed
+ * instance can be shared. 8-byte (temperature, errors) and 16-byte (settings)
+ * payloads use dedicated kernels, other sizes the generic btea() loop.
+ */
 class Xxtea
 {
 public:
@@ -23,17 +28,102 @@ public:
 
     int set_key(uint8_t *key, size_t len);
 
-    int encrypt(uint8_t *data, size_t len, uint8_t *buf, size_t *maxlen);
-    int encrypt(uint8_t *data, size_t len, uint8_t *buf);
-    int decrypt(uint8_t *data, size_t len);
-    int decrypt(uint8_t *data, size_t len, uint8_t *buf);
+    int encrypt(uint8_t *data, size_t len, uint8_t *buf, size_t *maxlen) const;
+    int encrypt(uint8_t *data, size_t len, uint8_t *buf) const;
+    int decrypt(uint8_t *data, size_t len) const;
+    int decrypt(uint8_t *data, size_t len, uint8_t *buf) const;
 
-    int status() { return this->status_; }
+    int status() const { return this->status_; }
+
+    // In-place kernels for a block of N 32-bit words
+    template <int N> static void encrypt_block(uint32_t *v, uint32_t const k[4]);
+    template <int N> static void decrypt_block(uint32_t *v, uint32_t const k[4]);
+
+    // Decrypts many independent N-word blocks (e.g. one per valve) in one call. Data is laid out
+    // structure-of-arrays: v[w * lanes + i] is word w of lane i, k[j * lanes + i] key word j of lane i.
+    // The innermost loop runs across lanes, so the compiler can vectorize it where the target allows.
+    template <int N> static void decrypt_lanes(uint32_t *v, const uint32_t *k, size_t lanes);
+    // Runtime dispatch of decrypt_lanes<N> for the supported payload sizes (8 and 16 bytes)
+    static int decrypt_lanes(uint32_t *v, const uint32_t *k, size_t words, size_t lanes);
+    // Key words as used by the kernels, for building the lane key array
+    const uint32_t *key_words() const { return this->xxtea_key; }
 
 private:
-    void btea(uint32_t *v, int32_t n, uint32_t const k[4]);
-    
+    static void btea(uint32_t *v, int32_t n, uint32_t const k[4]);
+    static void crypt_words(uint32_t *v, int32_t n, uint32_t const k[4]);
+
     int status_;
-    uint32_t xxtea_data[MAX_XXTEA_DATA32];
     uint32_t xxtea_key[MAX_XXTEA_KEY32];
 };
+
+#define XXTEA_MX (((z >> 5) ^ (y << 2)) + ((y >> 3) ^ (z << 4))) ^ ((sum ^ y) + (k[(p & 3) ^ e] ^ z))
+
+template <int N> void Xxtea::encrypt_block(uint32_t *v, uint32_t const k[4])
+{
+    static_assert(N > 1, "XXTEA needs at least two words");
+    uint32_t y, z = v[N - 1], sum = 0, e;
+    uint32_t rounds = 6 + 52 / N;
+    do
+    {
+        sum += XXTEA_DELTA;
+        e = (sum >> 2) & 3;
+#pragma GCC unroll 16
+        for (uint32_t p = 0; p < N - 1; p++)
+        {
+            y = v[p + 1];
+            z = v[p] += XXTEA_MX;
+        }
+        uint32_t p = N - 1;
+        y = v[0];
+        z = v[N - 1] += XXTEA_MX;
+    } while (--rounds);
+}
+
+template <int N> void Xxtea::decrypt_block(uint32_t *v, uint32_t const k[4])
+{
+    static_assert(N > 1, "XXTEA needs at least two words");
+    uint32_t rounds = 6 + 52 / N;
+    uint32_t y = v[0], z, sum = rounds * XXTEA_DELTA, e;
+    do
+    {
+        e = (sum >> 2) & 3;
+#pragma GCC unroll 16
+        for (uint32_t p = N - 1; p > 0; p--)
+        {
+            z = v[p - 1];
+            y = v[p] -= XXTEA_MX;
+        }
+        uint32_t p = 0;
+        z = v[N - 1];
+        y = v[0] -= XXTEA_MX;
+        sum -= XXTEA_DELTA;
+    } while (--rounds);
+}
+
+template <int N> void Xxtea::decrypt_lanes(uint32_t *v, const uint32_t *k, size_t lanes)
+{
+    static_assert(N > 1, "XXTEA needs at least two words");
+    uint32_t rounds = 6 + 52 / N;
+    uint32_t sum = rounds * XXTEA_DELTA;
+    do
+    {
+        uint32_t e = (sum >> 2) & 3;
+        // Same word order as decrypt_block(): y is the next word (already updated), z the previous one
+        for (int w = N - 1; w >= 0; w--)
+        {
+            uint32_t p = w;
+            uint32_t *cur = v + w * lanes;
+            const uint32_t *next = v + ((w + 1) % N) * lanes;
+            const uint32_t *prev = v + ((w + N - 1) % N) * lanes;
+            const uint32_t *key = k + ((p & 3) ^ e) * lanes;
+            for (size_t i = 0; i < lanes; i++)
+            {
+                uint32_t y = next[i], z = prev[i];
+                cur[i] -= (((z >> 5) ^ (y << 2)) + ((y >> 3) ^ (z << 4))) ^ ((sum ^ y) + (key[i] ^ z));
+            }
+        }
+        sum -= XXTEA_DELTA;
+    } while (--rounds);
+}
+
+#undef XXTEA_MX
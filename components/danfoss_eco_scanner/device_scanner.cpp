@@ -1,38 +1,109 @@
+#include "esphome/core/hal.h"
 #include "esphome/core/log.h"
 
 #include "device_scanner.h"
 
+#include <cstring>
+
 #ifdef USE_ESP32
 
 namespace esphome
 {
     namespace danfoss_eco_scanner
     {
-        static const string eTRV_SUFFIX = string(";eTRV");
+        static const char eTRV_SUFFIX[] = ";eTRV";
+        static const size_t eTRV_SUFFIX_LEN = sizeof(eTRV_SUFFIX) - 1;
+        // Danfoss OUI (00:04:2F), eTRVs advertise with their public address
+        static const uint32_t DANFOSS_OUI = 0x00042F;
 
         void DanfossEcoScanner::dump_config()
         {
             ESP_LOGCONFIG(TAG, "Danfoss Eco Scanner:");
             ESP_LOGCONFIG(TAG, "  Read Secret: %d", this->read_secret_);
+
+            uint32_t now = millis();
+            for (auto &adv : this->cache_)
+            {
+                if (adv.address == 0)
+                    continue;
+                ESP_LOGCONFIG(TAG, "  %012llX: RSSI %.0f dBm, seen %" PRIu32 " s ago, secret %s", (unsigned long long)adv.address,
+                              adv.rssi, (now - adv.last_seen) / 1000, adv.secret_readable() ? "readable" : "locked");
+            }
         }
 
         bool DanfossEcoScanner::parse_device(const ESPBTDevice &device)
         {
-            string name = device.get_name();
-            int s_len = eTRV_SUFFIX.length();
+            // Called for every advertisement in the air, so reject on the address before touching the name
+            uint64_t address = device.address_uint64();
+            if ((address >> 24) != DANFOSS_OUI)
+                return false;
 
-            if (name.length() <= s_len || name.compare(name.length() - s_len, s_len, eTRV_SUFFIX) != 0)
+            const string &name = device.get_name();
+            if (name.length() <= eTRV_SUFFIX_LEN ||
+                memcmp(name.data() + name.length() - eTRV_SUFFIX_LEN, eTRV_SUFFIX, eTRV_SUFFIX_LEN) != 0)
                 return false;
 
-            ESP_LOGI(TAG, "Found Danfoss eTRV, MAC: %s, Name: %s", device.address_str().c_str(), name.c_str());
+            uint8_t flags = (uint8_t)name[0];
+            Advertisement *adv = this->slot_for_(address);
+
+            if (adv->address != address)
+            {
+                // Only newly heard valves are logged at INFO, repeats would flood the log
+                ESP_LOGI(TAG, "Found Danfoss eTRV, MAC: %s, Name: %s", device.address_str().c_str(), name.c_str());
+                adv->address = address;
+                adv->rssi = device.get_rssi();
+            }
+            else
+            {
+                ESP_LOGV(TAG, "Danfoss eTRV %s, RSSI %d dBm", device.address_str().c_str(), device.get_rssi());
+                adv->rssi = RSSI_SMOOTHING * device.get_rssi() + (1.0f - RSSI_SMOOTHING) * adv->rssi;
+            }
 
-            uint8_t flags = (uint8_t)name.c_str()[0];
-            if ((flags & 0x4) >> 2)
+            if ((flags & FLAG_SECRET_READABLE) && !adv->secret_readable())
                 ESP_LOGI(TAG, "Ready to read the secret key");
 
+            adv->flags = flags;
+            adv->last_seen = millis();
             return true;
         }
 
+        const Advertisement *DanfossEcoScanner::find(uint64_t address) const
+        {
+            for (auto &adv : this->cache_)
+            {
+                if (adv.address == address)
+                    return &adv;
+            }
+            return nullptr;
+        }
+
+        bool DanfossEcoScanner::is_reachable(uint64_t address, uint32_t max_age_ms, int min_rssi) const
+        {
+            const Advertisement *adv = this->find(address);
+            return adv != nullptr && millis() - adv->last_seen <= max_age_ms && adv->rssi >= min_rssi;
+        }
+
+        Advertisement *DanfossEcoScanner::slot_for_(uint64_t address)
+        {
+            // Existing entry, else a free slot, else the one heard longest ago (cleared)
+            for (auto &adv : this->cache_)
+            {
+                if (adv.address == address)
+                    return &adv;
+            }
+            uint32_t now = millis();
+            Advertisement *oldest = &this->cache_[0];
+            for (auto &adv : this->cache_)
+            {
+                if (adv.address == 0)
+                    return &adv;
+                if (now - adv.last_seen > now - oldest->last_seen)
+                    oldest = &adv;
+            }
+            *oldest = Advertisement();
+            return oldest;
+        }
+
     } // namespace danfoss_eco_scanner
 } // namespace esphome
 
@@ -12,9 +12,28 @@ namespace esphome
         using namespace std;
         using namespace esphome::esp32_ble_tracker;
 
-        static auto DANFOSS_UUID = ESPBTUUID::from_uint16(0x042f);
         const char *const TAG = "danfoss_eco_scanner";
 
+        // Number of valves remembered by the scanner, the least recently heard one is replaced when full
+        static const uint8_t ADVERTISEMENT_CACHE_SIZE = 16;
+        // Weight of the newest sample in the smoothed RSSI
+        static const float RSSI_SMOOTHING = 0.25f;
+        // Flags (first character of the advertised name) bit set while the secret key can be read
+        static const uint8_t FLAG_SECRET_READABLE = 0x4;
+
+        /**
+         * Last advertisement heard from a Danfoss eTRV
+         */
+        struct Advertisement
+        {
+            uint64_t address{0}; // 0 marks a free slot
+            uint32_t last_seen{0};
+            float rssi{0.0f};
+            uint8_t flags{0};
+
+            bool secret_readable() const { return (this->flags & FLAG_SECRET_READABLE) != 0; }
+        };
+
         class DanfossEcoScanner : public ESPBTDeviceListener, public Component
         {
         public:
@@ -25,8 +44,16 @@ namespace esphome
 
             void set_read_secret(bool read_secret) { this->read_secret_ = read_secret; }
 
+            // Returns the cached advertisement for this MAC, or nullptr if it was never heard
+            const Advertisement *find(uint64_t address) const;
+            // True if the valve was heard within max_age_ms, with a smoothed RSSI of at least min_rssi
+            bool is_reachable(uint64_t address, uint32_t max_age_ms, int min_rssi) const;
+
         private:
+            Advertisement *slot_for_(uint64_t address);
+
             bool read_secret_{false};
+            Advertisement cache_[ADVERTISEMENT_CACHE_SIZE];
         };
 
     } // namespace danfoss_eco_scanner
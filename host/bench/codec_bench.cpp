@@ -0,0 +1,149 @@
+// Value codecs of the properties and the hex/byte-order helpers
+
+#include <benchmark/benchmark.h>
+#include <cstdio>
+#include <cstring>
+#include "esphome/components/danfoss_eco/device_data.h"
+#include "esphome/components/danfoss_eco/helpers.h"
+#include "valve_harness.h"
+
+namespace esphome {
+namespace danfoss_eco {
+namespace sim {
+
+static Xxtea keyed_xxtea() {
+  Xxtea xxtea;
+  uint8_t key[16];
+  parse_hex_str(HARNESS_SECRET_KEY, 32, key);
+  xxtea.set_key(key, sizeof(key));
+  return xxtea;
+}
+
+// Ciphertext of len bytes as the valve would send it, decode() doesn't modify it
+static void valve_value(const Xxtea &xxtea, size_t len, uint8_t *out) {
+  uint8_t plain[MAX_XXTEA_DATA8];
+  for (size_t i = 0; i < len; i++)
+    plain[i] = 40 + i;
+  xxtea.encrypt(plain, len, out);
+}
+
+static void BM_TemperatureDecode(benchmark::State &state) {
+  Xxtea xxtea = keyed_xxtea();
+  TemperatureData data(&xxtea);
+  uint8_t raw[8];
+  valve_value(xxtea, sizeof(raw), raw);
+  for (auto _ : state) {
+    data.decode(raw, sizeof(raw));
+    benchmark::DoNotOptimize(data.room_temperature);
+  }
+}
+BENCHMARK(BM_TemperatureDecode);
+
+static void BM_TemperaturePack(benchmark::State &state) {
+  Xxtea xxtea = keyed_xxtea();
+  TemperatureData data(&xxtea);
+  data.target_temperature = 21.5f;
+  uint8_t out[8];
+  for (auto _ : state) {
+    data.pack(out);
+    benchmark::DoNotOptimize(out);
+  }
+}
+BENCHMARK(BM_TemperaturePack);
+
+static void BM_SettingsDecode(benchmark::State &state) {
+  Xxtea xxtea = keyed_xxtea();
+  SettingsData data(&xxtea);
+  uint8_t raw[16];
+  valve_value(xxtea, sizeof(raw), raw);
+  for (auto _ : state) {
+    data.decode(raw, sizeof(raw));
+    benchmark::DoNotOptimize(data.device_mode);
+  }
+}
+BENCHMARK(BM_SettingsDecode);
+
+// Pack with a pending mode and limit change applied on top of the last read image
+static void BM_SettingsPack(benchmark::State &state) {
+  Xxtea xxtea = keyed_xxtea();
+  SettingsData data(&xxtea);
+  uint8_t raw[16];
+  valve_value(xxtea, sizeof(raw), raw);
+  data.decode(raw, sizeof(raw));
+  data.pending_mask = SETTINGS_MODE | SETTINGS_LIMITS;
+  data.pending_mode = climate::CLIMATE_MODE_AUTO;
+  data.pending_min = 8.0f;
+  data.pending_max = 26.0f;
+  uint8_t out[16];
+  for (auto _ : state) {
+    data.pack(out);
+    benchmark::DoNotOptimize(out);
+  }
+}
+BENCHMARK(BM_SettingsPack);
+
+static void BM_ErrorsDecode(benchmark::State &state) {
+  Xxtea xxtea = keyed_xxtea();
+  ErrorsData data(&xxtea);
+  uint8_t raw[8];
+  valve_value(xxtea, sizeof(raw), raw);
+  for (auto _ : state) {
+    data.decode(raw, sizeof(raw));
+    benchmark::DoNotOptimize(data.E10_INVALID_TIME);
+  }
+}
+BENCHMARK(BM_ErrorsDecode);
+
+static void BM_ParseHexStr(benchmark::State &state) {
+  uint8_t key[16];
+  for (auto _ : state) {
+    parse_hex_str(HARNESS_SECRET_KEY, 32, key);
+    benchmark::DoNotOptimize(key);
+  }
+  state.SetBytesProcessed(state.iterations() * sizeof(key));
+}
+BENCHMARK(BM_ParseHexStr);
+
+static void BM_EncodeHex(benchmark::State &state) {
+  uint8_t key[16];
+  parse_hex_str(HARNESS_SECRET_KEY, 32, key);
+  char hex[33];
+  for (auto _ : state) {
+    encode_hex(key, sizeof(key), hex);
+    benchmark::DoNotOptimize(hex);
+  }
+  state.SetBytesProcessed(state.iterations() * sizeof(key));
+}
+BENCHMARK(BM_EncodeHex);
+
+// encode_hex as it was before the lookup table, one sprintf per byte
+static void BM_EncodeHexSprintf(benchmark::State &state) {
+  uint8_t key[16];
+  parse_hex_str(HARNESS_SECRET_KEY, 32, key);
+  char hex[33];
+  for (auto _ : state) {
+    for (size_t i = 0; i < sizeof(key); i++)
+      sprintf(hex + i * 2, "%02x", key[i]);
+    hex[sizeof(key) * 2] = '\0';
+    benchmark::DoNotOptimize(hex);
+  }
+  state.SetBytesProcessed(state.iterations() * sizeof(key));
+}
+BENCHMARK(BM_EncodeHexSprintf);
+
+// 20 bytes, the size of the longest value (a schedule chunk)
+static void BM_ReverseChunks(benchmark::State &state) {
+  uint8_t data[20], reversed[20];
+  for (size_t i = 0; i < sizeof(data); i++)
+    data[i] = i;
+  for (auto _ : state) {
+    reverse_chunks(data, sizeof(data), reversed);
+    benchmark::DoNotOptimize(reversed);
+  }
+  state.SetBytesProcessed(state.iterations() * sizeof(data));
+}
+BENCHMARK(BM_ReverseChunks);
+
+}  // namespace sim
+}  // namespace danfoss_eco
+}  // namespace esphome
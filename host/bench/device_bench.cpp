@@ -0,0 +1,120 @@
+// Component code paths driven against the simulated valve, deterministic so the timings are comparable between runs
+
+#include <benchmark/benchmark.h>
+#include <chrono>
+#include "esphome/components/danfoss_eco/device.h"
+#include "host_support.h"
+#include "valve_harness.h"
+
+namespace esphome {
+namespace danfoss_eco {
+namespace sim {
+
+// Steps the harness, jumping the clock straight to each response instead of ticking through the latency
+static void run_until_quiet(ValveHarness &h) {
+  uint32_t at;
+  h.step();
+  while (h.valve.next_event_at(&at)) {
+    host::set_millis(at);
+    h.step();
+  }
+}
+
+// One poll: refresh queued, requests sent by Device::loop, answered through Device::gattc_event_handler
+static void BM_RefreshCycle(benchmark::State &state) {
+  ValveHarness h;
+  h.setup();
+  h.run_until_established();
+  h.run_for(2000);
+  for (auto _ : state) {
+    h.component.update();
+    run_until_quiet(h);
+    // Vary the value so every read is decoded and published
+    h.valve.room_temperature = h.valve.room_temperature == 20.0f ? 20.5f : 20.0f;
+  }
+}
+BENCHMARK(BM_RefreshCycle);
+
+// Device::loop with nothing queued, the cost of every main loop iteration while connected
+static void BM_IdleLoop(benchmark::State &state) {
+  ValveHarness h;
+  h.setup();
+  h.run_until_established();
+  h.run_for(10000);
+  for (auto _ : state) {
+    h.component.loop();
+  }
+}
+BENCHMARK(BM_IdleLoop);
+
+// ESP_GATTC_READ_CHAR_EVT for a temperature read nobody asked for: dispatch and matching only
+static void BM_GattcEventUnexpected(benchmark::State &state) {
+  ValveHarness h;
+  h.setup();
+  h.run_until_established();
+  h.run_for(10000);
+  uint8_t value[8]{};
+  esp_ble_gattc_cb_param_t param{};
+  param.read.status = ESP_GATT_OK;
+  param.read.handle = h.valve.handle(CharacteristicId::TEMPERATURE);
+  param.read.value = value;
+  param.read.value_len = sizeof(value);
+  for (auto _ : state) {
+    h.component.gattc_event_handler(ESP_GATTC_READ_CHAR_EVT, h.client.get_gattc_if(), &param);
+  }
+}
+BENCHMARK(BM_GattcEventUnexpected);
+
+// Expected responses (Read Multiple and the settings read of a poll) handed to the component: matching
+// against the in-flight command, decoding and publishing. Only the deliver() calls are timed, which
+// includes building the event parameters in the simulated valve.
+static void BM_ResponseDispatch(benchmark::State &state) {
+  ValveHarness h;
+  h.setup();
+  h.run_until_established();
+  h.run_for(2000);
+  uint64_t events = 0;
+  for (auto _ : state) {
+    h.valve.room_temperature = h.valve.room_temperature == 20.0f ? 20.5f : 20.0f;
+    h.component.update();
+    h.step();
+    double elapsed = 0;
+    uint32_t at;
+    while (h.valve.next_event_at(&at)) {
+      host::set_millis(at);
+      auto start = std::chrono::steady_clock::now();
+      events += h.valve.deliver(&h.client, at);
+      elapsed += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+      h.step();
+    }
+    state.SetIterationTime(elapsed);
+  }
+  // items_per_second is events per second of dispatch time
+  state.SetItemsProcessed(events);
+}
+BENCHMARK(BM_ResponseDispatch)->UseManualTime();
+
+// TemperatureProperty::update_state with a changed value (decrypt, decode, publish) and an unchanged one
+static void BM_TemperatureUpdateState(benchmark::State &state) {
+  ValveHarness h;
+  h.setup();
+  auto xxtea = std::make_shared<Xxtea>();
+  uint8_t key[16] = {0x00, 0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77, 0x88, 0x99, 0xaa, 0xbb, 0xcc, 0xdd, 0xee, 0xff};
+  xxtea->set_key(key, sizeof(key));
+  TemperatureProperty prop(&h.component, xxtea);
+  uint8_t values[2][8];
+  for (uint8_t i = 0; i < 2; i++) {
+    uint8_t plain[8] = {(uint8_t) (40 + i), 42};
+    xxtea->encrypt(plain, 8, values[i]);
+  }
+  bool changing = state.range(0) != 0;
+  uint32_t n = 0;
+  for (auto _ : state) {
+    prop.update_state(values[changing ? n++ & 1 : 0], 8);
+  }
+}
+BENCHMARK(BM_TemperatureUpdateState)->ArgName("changing")->Arg(0)->Arg(1);
+
+}  // namespace sim
+}  // namespace danfoss_eco
+}  // namespace esphome
@@ -0,0 +1,44 @@
+// Refresh latency on the simulated valve with and without Read Multiple. Times are simulated
+// milliseconds (reported through manual time), not the CPU time spent in the component.
+
+#include <benchmark/benchmark.h>
+#include "host_support.h"
+#include "valve_harness.h"
+
+namespace esphome {
+namespace danfoss_eco {
+namespace sim {
+
+static void BM_RefreshLatency(benchmark::State &state) {
+  ValveConfig config;
+  config.jitter_ms = 30;
+  ValveHarness h(config);
+  bool read_multiple = state.range(0) != 0;
+  h.setup([&](MyComponent &c) { c.set_read_multiple(read_multiple); });
+  h.run_until_established();
+  h.run_for(2000);
+
+  uint32_t requests = 0;
+  for (auto _ : state) {
+    uint32_t before = h.valve.reads + h.valve.read_multiples;
+    uint32_t start = millis();
+    h.component.update();
+    uint32_t at;
+    h.step();
+    while (h.valve.next_event_at(&at)) {
+      host::set_millis(at);
+      h.step();
+    }
+    state.SetIterationTime((millis() - start) / 1000.0);
+    requests += h.valve.reads + h.valve.read_multiples - before;
+    h.valve.room_temperature = h.valve.room_temperature == 20.0f ? 20.5f : 20.0f;
+  }
+  state.counters["requests"] = benchmark::Counter(requests, benchmark::Counter::kAvgIterations);
+}
+BENCHMARK(BM_RefreshLatency)->ArgName("read_multiple")->Arg(0)->Arg(1)->Iterations(100)
+    ->UseManualTime()
+    ->Unit(benchmark::kMillisecond);
+
+}  // namespace sim
+}  // namespace danfoss_eco
+}  // namespace esphome
@@ -0,0 +1,52 @@
+// Time from setup() after a reboot until the first temperature is published, with and without the GATT
+// handles cached by the previous run. Times are simulated milliseconds (reported through manual time).
+// The simulated stack holds requests made during service discovery until it has completed, like Bluedroid.
+
+#include <benchmark/benchmark.h>
+#include "host_support.h"
+#include "valve_harness.h"
+
+namespace esphome {
+namespace danfoss_eco {
+namespace sim {
+
+static void BM_RebootToFirstRead(benchmark::State &state) {
+  bool cached = state.range(0) != 0;
+  bool pin = state.range(1) != 0;
+  ValveConfig config;
+  config.jitter_ms = 30;
+  if (pin) config.pin = 1234;
+  auto configure = [&](MyComponent &c) {
+    if (pin) c.set_pin_code("1234");
+  };
+  {
+    // Saves the handles for the runs below
+    ValveHarness h(config);
+    h.setup(configure);
+    h.run_until_established();
+    h.run_for(2000);
+  }
+
+  uint32_t n = 0;
+  for (auto _ : state) {
+    ValveHarness h(config, cached);
+    // Differs from the state restored from the last run, so only a read from the valve matches it
+    float room = 15.0f + (n++ % 10) * 0.5f;
+    h.valve.room_temperature = room;
+    h.setup(configure);
+    uint32_t start = millis();
+    if (!h.run_until([&]() { return h.temperature.has_state() && h.temperature.state == room; }, 30000)) {
+      state.SkipWithError("temperature was not read");
+      break;
+    }
+    state.SetIterationTime((millis() - start) / 1000.0);
+    config.seed++;
+  }
+}
+BENCHMARK(BM_RebootToFirstRead)->ArgNames({"cached", "pin"})->ArgsProduct({{0, 1}, {0, 1}})->Iterations(50)
+    ->UseManualTime()
+    ->Unit(benchmark::kMillisecond);
+
+}  // namespace sim
+}  // namespace danfoss_eco
+}  // namespace esphome
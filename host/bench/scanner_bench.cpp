@@ -0,0 +1,55 @@
+// Scanner listener fed the busy-air advertisement corpus, as the tracker would call it
+
+#include <benchmark/benchmark.h>
+#include "esphome/components/danfoss_eco_scanner/device_scanner.h"
+#include "adv_corpus.h"
+#include "host_support.h"
+#include "scanner_baseline.h"
+
+namespace esphome {
+namespace danfoss_eco {
+namespace sim {
+
+// Time per advertisement over the whole corpus; almost all of them are rejected
+static void BM_ParseDeviceCorpus(benchmark::State &state) {
+  auto corpus = load_busy_air_corpus();
+  if (corpus.empty()) {
+    state.SkipWithError("advertisement corpus not found");
+    return;
+  }
+  host::set_millis(100000);
+  danfoss_eco_scanner::DanfossEcoScanner scanner;
+  size_t accepted = 0;
+  for (auto _ : state) {
+    for (auto &device : corpus)
+      accepted += scanner.parse_device(device);
+  }
+  state.SetItemsProcessed(state.iterations() * corpus.size());
+  state.counters["accepted"] = benchmark::Counter((double) accepted / state.iterations() / corpus.size());
+}
+BENCHMARK(BM_ParseDeviceCorpus);
+
+// Same corpus through the baseline filter (name copied before anything is rejected)
+static void BM_ParseDeviceCorpusBaseline(benchmark::State &state) {
+  auto corpus = load_busy_air_corpus();
+  if (corpus.empty()) {
+    state.SkipWithError("advertisement corpus not found");
+    return;
+  }
+  host::set_millis(100000);
+  danfoss_eco_scanner::DanfossEcoScanner scanner;
+  size_t accepted = 0;
+  for (auto _ : state) {
+    for (auto &device : corpus) {
+      if (reference::baseline_is_etrv(device))
+        accepted += scanner.parse_device(device);
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * corpus.size());
+  state.counters["accepted"] = benchmark::Counter((double) accepted / state.iterations() / corpus.size());
+}
+BENCHMARK(BM_ParseDeviceCorpusBaseline);
+
+}  // namespace sim
+}  // namespace danfoss_eco
+}  // namespace esphome
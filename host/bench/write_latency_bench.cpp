@@ -0,0 +1,58 @@
+// Command-to-ack latency of user setpoint changes on an idle link and with background reads queued
+// continuously. Times are simulated milliseconds (reported through manual time), from perform() until
+// the valve's ESP_GATTC_WRITE_CHAR_EVT is delivered.
+
+#include <benchmark/benchmark.h>
+#include <algorithm>
+#include <vector>
+#include "host_support.h"
+#include "valve_harness.h"
+
+namespace esphome {
+namespace danfoss_eco {
+namespace sim {
+
+static void BM_WriteAckLatency(benchmark::State &state) {
+  ValveConfig config;
+  config.jitter_ms = 30;
+  ValveHarness h(config);
+  h.setup();
+  // poll_load:1 queues a refresh again as soon as the last one has been sent, 0 leaves the link idle
+  h.poll_load_ms = state.range(0);
+  h.run_until_established();
+  h.run_for(2000);
+
+  std::vector<uint32_t> samples;
+  uint32_t reads = h.valve.reads + h.valve.read_multiples;
+  uint32_t n = 0;
+  for (auto _ : state) {
+    // Lands the change at a different point of the refresh cycle each time
+    h.run_for(1 + (n * 37) % 200);
+    float target = (n++ & 1) ? 22.5f : 22.0f;
+    uint32_t acks = h.valve.write_acks;
+    uint32_t start = millis();
+    h.component.make_call().set_target_temperature(target).perform();
+    if (!h.run_until([&]() { return h.valve.write_acks != acks; }, 30000)) {
+      state.SkipWithError("setpoint write was not acknowledged");
+      break;
+    }
+    samples.push_back(h.valve.last_write_ack_at - start);
+    state.SetIterationTime(samples.back() / 1000.0);
+  }
+  if (samples.empty()) return;
+
+  std::sort(samples.begin(), samples.end());
+  state.counters["p50_ms"] = samples[samples.size() / 2];
+  state.counters["p95_ms"] = samples[samples.size() * 95 / 100];
+  state.counters["max_ms"] = samples.back();
+  // Background reads kept going while the changes were written
+  state.counters["reads"] =
+      benchmark::Counter(h.valve.reads + h.valve.read_multiples - reads, benchmark::Counter::kAvgIterations);
+}
+BENCHMARK(BM_WriteAckLatency)->ArgName("poll_load")->Arg(0)->Arg(1)->Iterations(200)
+    ->UseManualTime()
+    ->Unit(benchmark::kMillisecond);
+
+}  // namespace sim
+}  // namespace danfoss_eco
+}  // namespace esphome
@@ -0,0 +1,128 @@
+// XXTEA block kernels against the baseline generic loop, and the byte-level API used by the properties
+
+#include <benchmark/benchmark.h>
+#include <vector>
+#include "esphome/components/danfoss_eco/xxtea.h"
+#include "xxtea_baseline.h"
+
+namespace {
+
+uint8_t KEY[16] = {0x00, 0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77, 0x88, 0x99, 0xaa, 0xbb, 0xcc, 0xdd, 0xee, 0xff};
+const uint32_t KEY_WORDS[4] = {0x33221100, 0x77665544, 0xbbaa9988, 0xffeeddcc};
+
+template <int N> void BM_EncryptBlock(benchmark::State &state) {
+  uint32_t v[N] = {0};
+  for (auto _ : state) {
+    Xxtea::encrypt_block<N>(v, KEY_WORDS);
+    benchmark::DoNotOptimize(v);
+  }
+  state.SetBytesProcessed(state.iterations() * N * 4);
+}
+BENCHMARK_TEMPLATE(BM_EncryptBlock, 2);
+BENCHMARK_TEMPLATE(BM_EncryptBlock, 4);
+
+template <int N> void BM_DecryptBlock(benchmark::State &state) {
+  uint32_t v[N] = {0};
+  for (auto _ : state) {
+    Xxtea::decrypt_block<N>(v, KEY_WORDS);
+    benchmark::DoNotOptimize(v);
+  }
+  state.SetBytesProcessed(state.iterations() * N * 4);
+}
+BENCHMARK_TEMPLATE(BM_DecryptBlock, 2);
+BENCHMARK_TEMPLATE(BM_DecryptBlock, 4);
+
+// Baseline btea() on the same word counts; a negative count decrypts
+void BM_BaselineBtea(benchmark::State &state) {
+  const int32_t n = state.range(0);
+  const int32_t words = n < 0 ? -n : n;
+  uint32_t v[MAX_XXTEA_DATA32] = {0};
+  for (auto _ : state) {
+    XxteaBaseline::btea(v, n, KEY_WORDS);
+    benchmark::DoNotOptimize(v);
+  }
+  state.SetBytesProcessed(state.iterations() * words * 4);
+}
+BENCHMARK(BM_BaselineBtea)->ArgName("words")->Arg(2)->Arg(4)->Arg(-2)->Arg(-4);
+
+// Byte-level API, 8/16/20 bytes: temperature and errors, settings, schedule
+void BM_Encrypt(benchmark::State &state) {
+  Xxtea xxtea;
+  xxtea.set_key(KEY, sizeof(KEY));
+  uint8_t data[MAX_XXTEA_DATA8] = {0}, buf[MAX_XXTEA_DATA8];
+  for (auto _ : state) {
+    xxtea.encrypt(data, state.range(0), buf);
+    benchmark::DoNotOptimize(buf);
+  }
+  state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_Encrypt)->ArgName("bytes")->Arg(8)->Arg(16)->Arg(20);
+
+void BM_BaselineEncrypt(benchmark::State &state) {
+  XxteaBaseline xxtea;
+  xxtea.set_key(KEY, sizeof(KEY));
+  uint8_t data[MAX_XXTEA_DATA8] = {0}, buf[MAX_XXTEA_DATA8];
+  for (auto _ : state) {
+    xxtea.encrypt(data, state.range(0), buf);
+    benchmark::DoNotOptimize(buf);
+  }
+  state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_BaselineEncrypt)->ArgName("bytes")->Arg(8)->Arg(16)->Arg(20);
+
+void BM_Decrypt(benchmark::State &state) {
+  Xxtea xxtea;
+  xxtea.set_key(KEY, sizeof(KEY));
+  uint8_t data[MAX_XXTEA_DATA8] = {0};
+  for (auto _ : state) {
+    xxtea.decrypt(data, state.range(0));
+    benchmark::DoNotOptimize(data);
+  }
+  state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_Decrypt)->ArgName("bytes")->Arg(8)->Arg(16)->Arg(20);
+
+void BM_BaselineDecrypt(benchmark::State &state) {
+  XxteaBaseline xxtea;
+  xxtea.set_key(KEY, sizeof(KEY));
+  uint8_t data[MAX_XXTEA_DATA8] = {0};
+  for (auto _ : state) {
+    xxtea.decrypt(data, state.range(0));
+    benchmark::DoNotOptimize(data);
+  }
+  state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_BaselineDecrypt)->ArgName("bytes")->Arg(8)->Arg(16)->Arg(20);
+
+// decrypt_lanes() over one payload per valve, against the same payloads through one Xxtea::decrypt() each
+template <int N> void BM_DecryptLanes(benchmark::State &state) {
+  const size_t lanes = state.range(0);
+  std::vector<uint32_t> v(N * lanes), k(4 * lanes);
+  for (size_t i = 0; i < k.size(); i++)
+    k[i] = KEY_WORDS[i / lanes];
+  for (auto _ : state) {
+    Xxtea::decrypt_lanes<N>(v.data(), k.data(), lanes);
+    benchmark::DoNotOptimize(v.data());
+  }
+  state.SetItemsProcessed(state.iterations() * lanes);
+}
+BENCHMARK_TEMPLATE(BM_DecryptLanes, 2)->ArgName("lanes")->RangeMultiplier(2)->Range(1, 64);
+BENCHMARK_TEMPLATE(BM_DecryptLanes, 4)->ArgName("lanes")->RangeMultiplier(2)->Range(1, 64);
+
+template <int N> void BM_DecryptScalar(benchmark::State &state) {
+  const size_t lanes = state.range(0);
+  std::vector<Xxtea> valves(lanes);
+  for (auto &xxtea : valves)
+    xxtea.set_key(KEY, sizeof(KEY));
+  std::vector<uint8_t> data(N * 4 * lanes);
+  for (auto _ : state) {
+    for (size_t i = 0; i < lanes; i++)
+      valves[i].decrypt(&data[i * N * 4], N * 4);
+    benchmark::DoNotOptimize(data.data());
+  }
+  state.SetItemsProcessed(state.iterations() * lanes);
+}
+BENCHMARK_TEMPLATE(BM_DecryptScalar, 2)->ArgName("lanes")->RangeMultiplier(2)->Range(1, 64);
+BENCHMARK_TEMPLATE(BM_DecryptScalar, 4)->ArgName("lanes")->RangeMultiplier(2)->Range(1, 64);
+
+}  // namespace
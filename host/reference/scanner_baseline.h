@@ -0,0 +1,21 @@
+#pragma once
+
+#include <string>
+#include "esphome/components/esp32_ble_tracker/esp32_ble_tracker.h"
+
+namespace esphome {
+namespace danfoss_eco {
+namespace reference {
+
+// Advertisement filter of DanfossEcoScanner::parse_device before the address check: the name is
+// copied and its suffix compared against a static std::string, for every advertisement
+inline bool baseline_is_etrv(const esp32_ble_tracker::ESPBTDevice &device) {
+  static const std::string eTRV_SUFFIX = std::string(";eTRV");
+  std::string name = device.get_name();
+  size_t s_len = eTRV_SUFFIX.length();
+  return !(name.length() <= s_len || name.compare(name.length() - s_len, s_len, eTRV_SUFFIX) != 0);
+}
+
+}  // namespace reference
+}  // namespace danfoss_eco
+}  // namespace esphome
@@ -0,0 +1,31 @@
+#include "adv_corpus.h"
+
+#include <cstdlib>
+#include <fstream>
+
+namespace esphome {
+namespace danfoss_eco {
+namespace sim {
+
+std::vector<esp32_ble_tracker::ESPBTDevice> load_adv_corpus(const std::string &path) {
+  std::vector<esp32_ble_tracker::ESPBTDevice> devices;
+  std::ifstream in(path);
+  std::string line;
+  while (std::getline(in, line)) {
+    if (line.empty() || line[0] == '#') continue;
+    char *end;
+    uint64_t address = std::strtoull(line.c_str(), &end, 16);
+    int rssi = (int) std::strtol(end, &end, 10);
+    std::string name = *end == ' ' ? std::string(end + 1) : std::string();
+    devices.emplace_back(address, std::move(name), rssi);
+  }
+  return devices;
+}
+
+std::vector<esp32_ble_tracker::ESPBTDevice> load_busy_air_corpus() {
+  return load_adv_corpus(DANFOSS_ECO_HOST_DATA_DIR "/adv_corpus.txt");
+}
+
+}  // namespace sim
+}  // namespace danfoss_eco
+}  // namespace esphome
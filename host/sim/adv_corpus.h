@@ -0,0 +1,22 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include "esphome/components/esp32_ble_tracker/esp32_ble_tracker.h"
+
+namespace esphome {
+namespace danfoss_eco {
+namespace sim {
+
+/**
+ * Advertisements from a corpus file (host/data), one per line: address in hex, RSSI and an optional
+ * name. Lines starting with '#' are comments. Returns an empty list if the file can't be read.
+ */
+std::vector<esp32_ble_tracker::ESPBTDevice> load_adv_corpus(const std::string &path);
+
+// host/data/adv_corpus.txt, the busy-air corpus used by the scanner benchmarks and tests
+std::vector<esp32_ble_tracker::ESPBTDevice> load_busy_air_corpus();
+
+}  // namespace sim
+}  // namespace danfoss_eco
+}  // namespace esphome
@@ -0,0 +1,380 @@
+#include "simulated_valve.h"
+#include <algorithm>
+#include <cstring>
+#include "esphome/core/hal.h"
+
+namespace esphome {
+namespace danfoss_eco {
+namespace sim {
+
+static const uint8_t CHARACTERISTIC_COUNT = static_cast<uint8_t>(CharacteristicId::BATTERY) + 1;
+// Handles are spread out like on the valve, where each value has a declaration and a descriptor
+static const uint16_t HANDLE_STRIDE = 3;
+
+SimulatedValve::SimulatedValve(const uint8_t *key, const ValveConfig &config)
+    : config_(config), rng_(config.seed != 0 ? config.seed : 1) {
+  memcpy(this->key_, key, sizeof(this->key_));
+  this->xxtea_.set_key(this->key_, sizeof(this->key_));
+  // Every day heated 06:00-08:00 and 17:00-22:00
+  for (auto &chunk : this->schedule) {
+    for (uint8_t day = 0; day < SCHEDULE_DAYS_PER_CHUNK; day++) {
+      uint8_t *p = chunk + day * SCHEDULE_PERIODS * 2;
+      p[0] = 12;
+      p[1] = 16;
+      p[2] = 34;
+      p[3] = 44;
+    }
+  }
+}
+
+uint16_t SimulatedValve::handle(CharacteristicId id) const {
+  return this->handle_base_ + static_cast<uint8_t>(id) * HANDLE_STRIDE;
+}
+
+void SimulatedValve::set_handle_base(uint16_t base) { this->handle_base_ = base; }
+
+bool SimulatedValve::lookup_(uint16_t handle, CharacteristicId *id) const {
+  if (handle < this->handle_base_ || (handle - this->handle_base_) % HANDLE_STRIDE != 0) return false;
+  uint16_t index = (handle - this->handle_base_) / HANDLE_STRIDE;
+  if (index >= CHARACTERISTIC_COUNT) return false;
+  *id = static_cast<CharacteristicId>(index);
+  return *id != CharacteristicId::CURRENT_TIME || this->config_.current_time;
+}
+
+void SimulatedValve::populate(ble_client::BLEClient *client) const {
+  client->clear_characteristics();
+  for (uint8_t i = 0; i < CHARACTERISTIC_COUNT; i++) {
+    auto id = static_cast<CharacteristicId>(i);
+    if (id == CharacteristicId::CURRENT_TIME && !this->config_.current_time) continue;
+    client->add_characteristic(service_uuid(id), characteristic_uuid(id), this->handle(id));
+  }
+}
+
+uint16_t SimulatedValve::encode_(CharacteristicId id, uint8_t *out) const {
+  uint8_t plain[MAX_VALUE]{};
+  switch (id) {
+    case CharacteristicId::PIN:
+      memset(out, 0, 4);
+      return 4;
+    case CharacteristicId::SETTINGS:
+      plain[0] = this->mode;
+      plain[3] = (uint8_t) (this->temperature_min * 2);
+      plain[4] = (uint8_t) (this->temperature_max * 2);
+      this->xxtea_.encrypt(plain, 16, out);
+      return 16;
+    case CharacteristicId::TEMPERATURE:
+      plain[0] = (uint8_t) (this->room_temperature * 2);
+      plain[1] = (uint8_t) (this->target_temperature * 2);
+      this->xxtea_.encrypt(plain, 8, out);
+      return 8;
+    case CharacteristicId::CURRENT_TIME:
+      for (uint8_t i = 0; i < 4; i++) {
+        plain[i] = (this->time_local >> (i * 8)) & 0xFF;
+        plain[4 + i] = ((uint32_t) this->time_offset >> (i * 8)) & 0xFF;
+      }
+      this->xxtea_.encrypt(plain, 8, out);
+      return 8;
+    case CharacteristicId::ERRORS:
+      plain[0] = this->errors[0];
+      plain[1] = this->errors[1];
+      this->xxtea_.encrypt(plain, 8, out);
+      return 8;
+    case CharacteristicId::SECRET_KEY:
+      memcpy(out, this->key_, 16);
+      return 16;
+    case CharacteristicId::SCHEDULE_1:
+    case CharacteristicId::SCHEDULE_2:
+    case CharacteristicId::SCHEDULE_3: {
+      uint8_t chunk = static_cast<uint8_t>(id) - static_cast<uint8_t>(CharacteristicId::SCHEDULE_1);
+      this->xxtea_.encrypt(const_cast<uint8_t *>(this->schedule[chunk]), SCHEDULE_CHUNK_LENGTH, out);
+      return SCHEDULE_CHUNK_LENGTH;
+    }
+    case CharacteristicId::BATTERY:
+      out[0] = this->battery_level;
+      return 1;
+  }
+  return 0;
+}
+
+bool SimulatedValve::apply_write_(CharacteristicId id, const uint8_t *value, uint16_t value_len) {
+  uint8_t plain[MAX_VALUE];
+  switch (id) {
+    case CharacteristicId::PIN:
+      if (value_len != 4) return false;
+      this->pin_ok_ = (value[0] | (value[1] << 8) | (value[2] << 16) | ((uint32_t) value[3] << 24)) == this->config_.pin;
+      return this->pin_ok_;
+    case CharacteristicId::SETTINGS:
+      if (value_len != 16) return false;
+      this->xxtea_.decrypt(const_cast<uint8_t *>(value), 16, plain);
+      this->mode = plain[0];
+      this->temperature_min = plain[3] / 2.0f;
+      this->temperature_max = plain[4] / 2.0f;
+      return true;
+    case CharacteristicId::TEMPERATURE:
+      if (value_len != 8) return false;
+      this->xxtea_.decrypt(const_cast<uint8_t *>(value), 8, plain);
+      this->target_temperature = plain[1] / 2.0f;
+      return true;
+    case CharacteristicId::CURRENT_TIME:
+      if (value_len != 8) return false;
+      this->xxtea_.decrypt(const_cast<uint8_t *>(value), 8, plain);
+      this->time_local = plain[0] | (plain[1] << 8) | (plain[2] << 16) | ((uint32_t) plain[3] << 24);
+      this->time_offset = (int32_t) (plain[4] | (plain[5] << 8) | (plain[6] << 16) | ((uint32_t) plain[7] << 24));
+      // The valve re-evaluates E10 once its clock was set
+      this->errors[0] &= ~0x02;
+      return true;
+    case CharacteristicId::SCHEDULE_1:
+    case CharacteristicId::SCHEDULE_2:
+    case CharacteristicId::SCHEDULE_3: {
+      if (value_len != SCHEDULE_CHUNK_LENGTH) return false;
+      uint8_t chunk = static_cast<uint8_t>(id) - static_cast<uint8_t>(CharacteristicId::SCHEDULE_1);
+      this->xxtea_.decrypt(const_cast<uint8_t *>(value), SCHEDULE_CHUNK_LENGTH, this->schedule[chunk]);
+      return true;
+    }
+    default:
+      return false;
+  }
+}
+
+bool SimulatedValve::chance_(float rate) {
+  if (rate <= 0.0f) return false;
+  // xorshift32, the same sequence on every platform
+  this->rng_ ^= this->rng_ << 13;
+  this->rng_ ^= this->rng_ >> 17;
+  this->rng_ ^= this->rng_ << 5;
+  return (this->rng_ & 0xFFFFFF) < rate * 0x1000000;
+}
+
+uint32_t SimulatedValve::response_delay_() {
+  if (this->config_.jitter_ms == 0) return this->config_.latency_ms;
+  this->chance_(1.0f);
+  return this->config_.latency_ms + this->rng_ % (this->config_.jitter_ms + 1);
+}
+
+uint32_t SimulatedValve::sent_at_() const { return this->discovering_ ? this->discovered_at_ : millis(); }
+
+esp_err_t SimulatedValve::accept_(bool *dropped, esp_gatt_status_t *status) {
+  if (!this->connected_) return ESP_FAIL;
+  if (this->reject_next > 0) {
+    this->reject_next--;
+    return ESP_FAIL;
+  }
+  if (this->chance_(this->config_.reject_rate)) return ESP_FAIL;
+  this->last_request_at = millis();
+  *dropped = this->chance_(this->config_.drop_rate);
+  *status = this->chance_(this->config_.error_rate) ? ESP_GATT_ERROR : ESP_GATT_OK;
+  if (this->fail_next > 0) {
+    this->fail_next--;
+    *status = this->fail_status;
+  }
+  return ESP_OK;
+}
+
+void SimulatedValve::schedule_(const Event &event) {
+  auto it = std::upper_bound(this->events_.begin(), this->events_.end(), event.due,
+                             [](uint32_t due, const Event &e) { return (int32_t) (due - e.due) < 0; });
+  this->events_.insert(it, event);
+}
+
+esp_err_t SimulatedValve::read_char(uint16_t handle) {
+  bool dropped;
+  Event ev{};
+  if (this->accept_(&dropped, &ev.status) != ESP_OK) return ESP_FAIL;
+  this->reads++;
+  if (dropped) return ESP_OK;
+
+  ev.due = this->sent_at_() + this->response_delay_();
+  ev.event = ESP_GATTC_READ_CHAR_EVT;
+  ev.handle = handle;
+  CharacteristicId id;
+  if (handle == this->fail_handle) {
+    ev.status = this->fail_status;
+    this->failed_handle_requests++;
+  } else if (!this->lookup_(handle, &id)) {
+    ev.status = ESP_GATT_INVALID_HANDLE;
+    this->invalid_handles++;
+  } else if (this->config_.pin != 0 && !this->pin_ok_ && id != CharacteristicId::BATTERY) {
+    ev.status = ESP_GATT_INSUF_AUTHENTICATION;
+  } else if (ev.status == ESP_GATT_OK) {
+    ev.value_len = this->encode_(id, ev.value);
+    if (this->truncate_next > 0) {
+      this->truncate_next--;
+      ev.value_len /= 2;
+    }
+  }
+  this->schedule_(ev);
+  return ESP_OK;
+}
+
+esp_err_t SimulatedValve::read_multiple(const esp_gattc_multi_t &multi) {
+  bool dropped;
+  Event ev{};
+  if (this->accept_(&dropped, &ev.status) != ESP_OK) return ESP_FAIL;
+  this->read_multiples++;
+  if (dropped) return ESP_OK;
+
+  ev.due = this->sent_at_() + this->response_delay_();
+  ev.event = ESP_GATTC_READ_MULTIPLE_EVT;
+  if (!this->config_.read_multiple) {
+    ev.status = ESP_GATT_REQ_NOT_SUPPORTED;
+  } else if (ev.status == ESP_GATT_OK) {
+    // Plain concatenation of the values, cut at MTU - 1 bytes
+    uint8_t value[MAX_VALUE];
+    uint16_t len = 0;
+    for (uint8_t i = 0; i < multi.num_attr; i++) {
+      CharacteristicId id;
+      if (!this->lookup_(multi.handles[i], &id)) {
+        ev.status = ESP_GATT_INVALID_HANDLE;
+        this->invalid_handles++;
+        break;
+      }
+      if (this->config_.pin != 0 && !this->pin_ok_) {
+        ev.status = ESP_GATT_INSUF_AUTHENTICATION;
+        break;
+      }
+      uint8_t part[MAX_VALUE];
+      uint16_t part_len = this->encode_(id, part);
+      uint16_t room = std::min<uint16_t>(this->config_.mtu - 1, MAX_VALUE) - len;
+      part_len = std::min(part_len, room);
+      memcpy(value + len, part, part_len);
+      len += part_len;
+    }
+    if (ev.status == ESP_GATT_OK) {
+      memcpy(ev.value, value, len);
+      ev.value_len = len;
+    }
+  }
+  this->schedule_(ev);
+  return ESP_OK;
+}
+
+esp_err_t SimulatedValve::write_char(uint16_t handle, const uint8_t *value, uint16_t value_len) {
+  bool dropped;
+  Event ev{};
+  if (this->accept_(&dropped, &ev.status) != ESP_OK) return ESP_FAIL;
+  this->writes++;
+  if (dropped) return ESP_OK;
+
+  ev.due = this->sent_at_() + this->response_delay_();
+  ev.event = ESP_GATTC_WRITE_CHAR_EVT;
+  ev.handle = handle;
+  CharacteristicId id;
+  if (!this->lookup_(handle, &id)) {
+    ev.status = ESP_GATT_INVALID_HANDLE;
+    this->invalid_handles++;
+  } else if (ev.status == ESP_GATT_OK) {
+    if (this->config_.pin != 0 && !this->pin_ok_ && id != CharacteristicId::PIN) {
+      ev.status = ESP_GATT_INSUF_AUTHENTICATION;
+    } else if (!this->apply_write_(id, value, value_len)) {
+      ev.status = ESP_GATT_WRITE_NOT_PERMIT;
+    }
+  }
+  this->schedule_(ev);
+  return ESP_OK;
+}
+
+esp_err_t SimulatedValve::update_conn_params(const esp_ble_conn_update_params_t &params) {
+  if (!this->connected_) return ESP_FAIL;
+  this->conn_param_updates++;
+  Event ev{};
+  ev.due = millis() + this->response_delay_();
+  ev.gap = true;
+  ev.conn_params = params;
+  this->schedule_(ev);
+  return ESP_OK;
+}
+
+void SimulatedValve::connect(uint32_t now) {
+  this->events_.clear();
+  Event open{};
+  open.due = now + this->config_.connect_ms;
+  open.event = ESP_GATTC_OPEN_EVT;
+  this->schedule_(open);
+  Event search{};
+  search.due = open.due + this->config_.discovery_ms;
+  search.event = ESP_GATTC_SEARCH_CMPL_EVT;
+  this->schedule_(search);
+  this->discovering_ = true;
+  this->discovered_at_ = search.due;
+}
+
+void SimulatedValve::disconnect(uint32_t now, int reason) {
+  this->events_.clear();
+  this->connected_ = false;
+  this->discovering_ = false;
+  Event ev{};
+  ev.due = now;
+  ev.event = ESP_GATTC_DISCONNECT_EVT;
+  ev.handle = reason;
+  this->schedule_(ev);
+}
+
+bool SimulatedValve::next_event_at(uint32_t *at) const {
+  if (this->events_.empty()) return false;
+  *at = this->events_.front().due;
+  return true;
+}
+
+uint32_t SimulatedValve::deliver(ble_client::BLEClient *client, uint32_t now) {
+  uint32_t delivered = 0;
+  while (!this->events_.empty() && (int32_t) (now - this->events_.front().due) >= 0) {
+    // Handlers may send the next request, which schedules more events
+    Event ev = this->events_.front();
+    this->events_.pop_front();
+    delivered++;
+
+    if (ev.gap) {
+      esp_ble_gap_cb_param_t param{};
+      auto &update = param.update_conn_params;
+      update.status = ESP_BT_STATUS_SUCCESS;
+      memcpy(update.bda, ev.conn_params.bda, sizeof(esp_bd_addr_t));
+      update.min_int = ev.conn_params.min_int;
+      update.max_int = ev.conn_params.max_int;
+      update.latency = ev.conn_params.latency;
+      update.conn_int = ev.conn_params.max_int;
+      update.timeout = ev.conn_params.timeout;
+      client->gap_event_handler(ESP_GAP_BLE_UPDATE_CONN_PARAMS_EVT, &param);
+      continue;
+    }
+
+    esp_ble_gattc_cb_param_t param{};
+    switch (ev.event) {
+      case ESP_GATTC_OPEN_EVT:
+        this->connected_ = true;
+        this->pin_ok_ = false;
+        param.open.status = ESP_GATT_OK;
+        param.open.mtu = this->config_.mtu;
+        memcpy(param.open.remote_bda, client->get_remote_bda(), sizeof(esp_bd_addr_t));
+        break;
+      case ESP_GATTC_SEARCH_CMPL_EVT:
+        this->discovering_ = false;
+        this->populate(client);
+        param.search_cmpl.status = ESP_GATT_OK;
+        break;
+      case ESP_GATTC_DISCONNECT_EVT:
+        param.disconnect.reason = ev.handle;
+        memcpy(param.disconnect.remote_bda, client->get_remote_bda(), sizeof(esp_bd_addr_t));
+        break;
+      case ESP_GATTC_WRITE_CHAR_EVT:
+        param.write.status = ev.status;
+        param.write.handle = ev.handle;
+        if (ev.status == ESP_GATT_OK) {
+          this->write_acks++;
+          this->last_write_ack_at = now;
+        }
+        break;
+      default:
+        param.read.status = ev.status;
+        param.read.handle = ev.handle;
+        param.read.value = ev.value_len > 0 ? ev.value : nullptr;
+        param.read.value_len = ev.value_len;
+        break;
+    }
+    client->gattc_event_handler(ev.event, client->get_gattc_if(), &param);
+  }
+  return delivered;
+}
+
+}  // namespace sim
+}  // namespace danfoss_eco
+}  // namespace esphome
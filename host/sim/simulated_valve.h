@@ -0,0 +1,144 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include "esphome/components/ble_client/ble_client.h"
+#include "host_support.h"
+#include "esphome/components/danfoss_eco/properties.h"
+#include "esphome/components/danfoss_eco/xxtea.h"
+
+namespace esphome {
+namespace danfoss_eco {
+namespace sim {
+
+/**
+ * Behaviour of a SimulatedValve. Times are simulated milliseconds, rates are out of 1.0
+ * and drawn from a generator seeded with `seed`, so a run is reproducible.
+ */
+struct ValveConfig {
+  uint32_t seed{1};
+  uint32_t connect_ms{400};    // CONNECTING until ESP_GATTC_OPEN_EVT
+  uint32_t discovery_ms{600};  // ESP_GATTC_OPEN_EVT until ESP_GATTC_SEARCH_CMPL_EVT
+  uint32_t latency_ms{45};     // request until response, about two connection events
+  uint32_t jitter_ms{0};       // added to latency_ms, uniformly distributed
+  uint16_t mtu{23};
+  bool read_multiple{true};    // false answers Read Multiple with ESP_GATT_REQ_NOT_SUPPORTED
+  float reject_rate{0.0f};     // request refused by the local stack (ESP_FAIL)
+  float error_rate{0.0f};      // answered with ESP_GATT_ERROR
+  float drop_rate{0.0f};       // never answered
+  uint32_t pin{0};             // 0 = no PIN, else reads fail until it was written
+  bool current_time{true};     // false leaves the clock characteristic out, like older firmware
+};
+
+/**
+ * Danfoss eTRV on the other end of a host BLEClient.
+ *
+ * Serves the PIN, settings, temperature, clock, errors, secret key and schedule characteristics
+ * (XXTEA encrypted like the real valve) plus the battery service, and answers the requests the
+ * component makes through esp_ble_gattc_* with the matching GATT events after the configured latency.
+ * Events are handed to the client by deliver(), whoever drives the simulation decides when.
+ */
+class SimulatedValve : public host::GattServer {
+ public:
+  SimulatedValve(const uint8_t *key, const ValveConfig &config);
+
+  ValveConfig &config() { return this->config_; }
+
+  // Services and characteristics found by discovery, as the client would see them
+  void populate(ble_client::BLEClient *client) const;
+  // Moves every characteristic to a new handle, like a firmware update would
+  void set_handle_base(uint16_t base);
+  uint16_t handle(CharacteristicId id) const;
+
+  // Schedules ESP_GATTC_OPEN_EVT and ESP_GATTC_SEARCH_CMPL_EVT
+  void connect(uint32_t now);
+  // Link lost: pending responses are dropped, ESP_GATTC_DISCONNECT_EVT is delivered right away
+  void disconnect(uint32_t now, int reason);
+  bool connected() const { return this->connected_; }
+
+  // Hands every event due by `now` to the client, returns the number delivered
+  uint32_t deliver(ble_client::BLEClient *client, uint32_t now);
+  // Time of the next scheduled event, false if there is none
+  bool next_event_at(uint32_t *at) const;
+
+  esp_err_t read_char(uint16_t handle) override;
+  esp_err_t read_multiple(const esp_gattc_multi_t &multi) override;
+  esp_err_t write_char(uint16_t handle, const uint8_t *value, uint16_t value_len) override;
+  esp_err_t update_conn_params(const esp_ble_conn_update_params_t &params) override;
+
+  // Valve state, as shown on its display
+  float room_temperature{20.5f};
+  float target_temperature{21.0f};
+  uint8_t mode{0};  // 0 manual, 1 scheduled, 2 vacation
+  float temperature_min{5.0f};
+  float temperature_max{28.0f};
+  uint8_t battery_level{87};
+  uint8_t errors[2]{};  // E9, E10 in bits 0-1 of [0], E14, E15 in bits 0-1 of [1]
+  uint32_t time_local{0};
+  int32_t time_offset{0};
+  uint8_t schedule[SCHEDULE_CHUNKS][SCHEDULE_CHUNK_LENGTH]{};
+
+  // One-off failures: the next reject_next requests are refused by the stack, the next fail_next
+  // answered with fail_status
+  uint8_t reject_next{0};
+  uint8_t fail_next{0};
+  esp_gatt_status_t fail_status{ESP_GATT_ERROR};
+  // The next truncate_next single reads answer with only the first half of the value
+  uint8_t truncate_next{0};
+  // Reads of this handle are answered with fail_status (0 = none)
+  uint16_t fail_handle{0};
+
+  // Requests seen, by kind
+  uint32_t reads{0};
+  uint32_t read_multiples{0};
+  uint32_t writes{0};
+  uint32_t invalid_handles{0};  // requests to a handle the valve doesn't have
+  uint32_t failed_handle_requests{0};  // reads answered with fail_status because of fail_handle
+  uint32_t conn_param_updates{0};
+  uint32_t last_request_at{0};
+  // Writes answered with ESP_GATT_OK, counted when the response is delivered
+  uint32_t write_acks{0};
+  uint32_t last_write_ack_at{0};
+
+ protected:
+  static const uint8_t MAX_VALUE = 64;
+
+  struct Event {
+    uint32_t due;
+    bool gap;
+    esp_gattc_cb_event_t event;
+    esp_gatt_status_t status;
+    uint16_t handle;
+    uint16_t value_len;
+    uint8_t value[MAX_VALUE];
+    esp_ble_conn_update_params_t conn_params;
+  };
+
+  bool lookup_(uint16_t handle, CharacteristicId *id) const;
+  // Current value of a characteristic as sent over the air, returns its length
+  uint16_t encode_(CharacteristicId id, uint8_t *out) const;
+  bool apply_write_(CharacteristicId id, const uint8_t *value, uint16_t value_len);
+  bool chance_(float rate);
+  uint32_t response_delay_();
+  // When a request made now goes on the air: like Bluedroid, the stack holds requests made during
+  // service discovery until it has completed
+  uint32_t sent_at_() const;
+  // Outcome of a request before the value is looked at: rejected by the stack, dropped, or answered
+  esp_err_t accept_(bool *dropped, esp_gatt_status_t *status);
+  void schedule_(const Event &event);
+
+  ValveConfig config_;
+  Xxtea xxtea_;
+  uint8_t key_[16];
+  uint16_t handle_base_{0x10};
+  bool connected_{false};
+  bool pin_ok_{false};
+  bool discovering_{false};
+  uint32_t discovered_at_{0};  // ESP_GATTC_SEARCH_CMPL_EVT of the current connection
+  uint32_t rng_;
+  std::deque<Event> events_;  // ordered by due time
+};
+
+}  // namespace sim
+}  // namespace danfoss_eco
+}  // namespace esphome
@@ -0,0 +1,88 @@
+#include "valve_harness.h"
+#include "esphome/core/hal.h"
+#include "host_support.h"
+
+namespace esphome {
+namespace danfoss_eco {
+namespace sim {
+
+const char *const HARNESS_SECRET_KEY = "00112233445566778899aabbccddeeff";
+
+static const uint8_t HARNESS_KEY[16] = {0x00, 0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77,
+                                        0x88, 0x99, 0xaa, 0xbb, 0xcc, 0xdd, 0xee, 0xff};
+
+ValveHarness::ValveHarness(const ValveConfig &config, bool keep_preferences) : valve(HARNESS_KEY, config) {
+  // Away from 0, so "never happened" timestamps don't look recent
+  host::set_millis(100000);
+  if (!keep_preferences) host::clear_preferences();
+  host::set_gatt_server(&this->valve);
+  this->client.set_address(HARNESS_ADDRESS);
+  this->client.register_ble_node(&this->component);
+  this->component.set_name("Living Room");
+  this->component.add_on_state_callback([this](climate::Climate &) { this->climate_publishes++; });
+}
+
+ValveHarness::~ValveHarness() { host::set_gatt_server(nullptr); }
+
+void ValveHarness::setup(const std::function<void(MyComponent &)> &configure) {
+  this->component.set_secret_key(HARNESS_SECRET_KEY);
+  this->component.set_battery_level(&this->battery);
+  this->component.set_temperature(&this->temperature);
+  this->component.set_problems(&this->problems);
+  this->component.set_stale(&this->stale);
+  if (configure) configure(this->component);
+  this->component.setup();
+}
+
+bool ValveHarness::established() const {
+  return this->client.state() == esp32_ble_tracker::ClientState::ESTABLISHED;
+}
+
+void ValveHarness::step() {
+  uint32_t now = millis();
+  if (this->client.enabled() && this->client.state() == esp32_ble_tracker::ClientState::IDLE) {
+    if (!this->idle_) {
+      this->idle_ = true;
+      this->idle_since_ = now;
+    } else if (now - this->idle_since_ >= this->reconnect_delay_ms) {
+      this->idle_ = false;
+      this->client.set_state(esp32_ble_tracker::ClientState::CONNECTING);
+      this->valve.connect(now);
+    }
+  } else {
+    this->idle_ = false;
+  }
+  if (!this->client.enabled() && this->valve.connected()) this->valve.disconnect(now, 0x16);
+
+  this->valve.deliver(&this->client, now);
+  if (this->poll_load_ms > 0 && this->established() && now - this->polled_at_ >= this->poll_load_ms) {
+    this->polled_at_ = now;
+    this->component.update();
+  }
+  this->component.loop();
+  host::advance_millis(1);
+}
+
+void ValveHarness::run_for(uint32_t ms) {
+  uint32_t end = millis() + ms;
+  while ((int32_t) (millis() - end) < 0) this->step();
+}
+
+bool ValveHarness::run_until(const std::function<bool()> &done, uint32_t timeout_ms) {
+  uint32_t end = millis() + timeout_ms;
+  while (!done()) {
+    if ((int32_t) (millis() - end) >= 0) return false;
+    this->step();
+  }
+  return true;
+}
+
+bool ValveHarness::run_until_established(uint32_t timeout_ms) {
+  return this->run_until([this]() { return this->established(); }, timeout_ms);
+}
+
+void ValveHarness::drop_link(int reason) { this->valve.disconnect(millis(), reason); }
+
+}  // namespace sim
+}  // namespace danfoss_eco
+}  // namespace esphome
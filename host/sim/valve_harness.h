@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include "esphome/components/binary_sensor/binary_sensor.h"
+#include "esphome/components/ble_client/ble_client.h"
+#include "esphome/components/sensor/sensor.h"
+#include "esphome/components/danfoss_eco/my_component.h"
+#include "simulated_valve.h"
+
+namespace esphome {
+namespace danfoss_eco {
+namespace sim {
+
+// Secret key of the simulated valve, as it would be given in the YAML
+extern const char *const HARNESS_SECRET_KEY;
+static const uint64_t HARNESS_ADDRESS = 0x00042F123456ULL;
+
+/**
+ * One climate component connected to a SimulatedValve through a host BLEClient.
+ *
+ * Owns the simulated clock: run_for()/run_until() step it in 1 ms ticks, delivering due GATT
+ * events and calling loop() like the ESPHome main loop would. The client reconnects on its own
+ * while enabled, after reconnect_delay_ms, so dropped links recover like on the device.
+ * poll_load_ms keeps a stream of background reads queued, to see how user changes fare behind them.
+ */
+class ValveHarness {
+ public:
+  // keep_preferences leaves what an earlier harness saved, like a reboot of the same node
+  explicit ValveHarness(const ValveConfig &config = {}, bool keep_preferences = false);
+  ~ValveHarness();
+
+  // Configures the component (before setup, like the generated code) and sets it up
+  void setup(const std::function<void(MyComponent &)> &configure = nullptr);
+
+  void step();
+  void run_for(uint32_t ms);
+  // Runs until `done` returns true, false on timeout
+  bool run_until(const std::function<bool()> &done, uint32_t timeout_ms);
+  // Runs until the link is established, false on timeout
+  bool run_until_established(uint32_t timeout_ms = 10000);
+  // Drops the link, the valve stops answering outstanding requests
+  void drop_link(int reason = 0x08);
+
+  bool established() const;
+
+  MyComponent component;
+  ble_client::BLEClient client;
+  SimulatedValve valve;
+  sensor::Sensor battery;
+  sensor::Sensor temperature;
+  binary_sensor::BinarySensor problems;
+  binary_sensor::BinarySensor stale;
+
+  uint32_t reconnect_delay_ms{1000};
+  // Calls update() this often while the link is up, on top of the component's own polling (0 = off)
+  uint32_t poll_load_ms{0};
+  uint32_t climate_publishes{0};
+
+ protected:
+  uint32_t idle_since_{0};
+  bool idle_{false};
+  uint32_t polled_at_{0};
+};
+
+}  // namespace sim
+}  // namespace danfoss_eco
+}  // namespace esphome
@@ -0,0 +1,110 @@
+#pragma once
+
+// Host stand-in for the ESP-IDF GATT client API, only what the component uses.
+// Requests are forwarded to the GattServer set with esphome::host::set_gatt_server().
+
+#include <cstddef>
+#include <cstdint>
+
+typedef int esp_err_t;
+#define ESP_OK 0
+#define ESP_FAIL -1
+
+typedef uint8_t esp_bd_addr_t[6];
+typedef uint8_t esp_gatt_if_t;
+
+typedef enum {
+  ESP_GATT_OK = 0x00,
+  ESP_GATT_INVALID_HANDLE = 0x01,
+  ESP_GATT_READ_NOT_PERMIT = 0x02,
+  ESP_GATT_WRITE_NOT_PERMIT = 0x03,
+  ESP_GATT_INVALID_PDU = 0x04,
+  ESP_GATT_INSUF_AUTHENTICATION = 0x05,
+  ESP_GATT_REQ_NOT_SUPPORTED = 0x06,
+  ESP_GATT_NOT_FOUND = 0x0a,
+  ESP_GATT_INVALID_ATTR_LEN = 0x0d,
+  ESP_GATT_ERROR = 0x85,
+  ESP_GATT_BUSY = 0x84,
+  ESP_GATT_NOT_SUPPORTED = 0x8d,
+  ESP_GATT_TIMEOUT = 0x94,
+} esp_gatt_status_t;
+
+typedef enum { ESP_GATT_AUTH_REQ_NONE = 0 } esp_gatt_auth_req_t;
+typedef enum { ESP_GATT_WRITE_TYPE_NO_RSP = 1, ESP_GATT_WRITE_TYPE_RSP = 2 } esp_gatt_write_type_t;
+
+typedef enum {
+  ESP_GATTC_REG_EVT = 0,
+  ESP_GATTC_UNREG_EVT = 1,
+  ESP_GATTC_OPEN_EVT = 2,
+  ESP_GATTC_READ_CHAR_EVT = 3,
+  ESP_GATTC_WRITE_CHAR_EVT = 4,
+  ESP_GATTC_CLOSE_EVT = 5,
+  ESP_GATTC_SEARCH_CMPL_EVT = 6,
+  ESP_GATTC_SEARCH_RES_EVT = 7,
+  ESP_GATTC_READ_MULTIPLE_EVT = 21,
+  ESP_GATTC_CFG_MTU_EVT = 18,
+  ESP_GATTC_CONNECT_EVT = 40,
+  ESP_GATTC_DISCONNECT_EVT = 41,
+} esp_gattc_cb_event_t;
+
+#define ESP_GATT_MAX_READ_MULTI_HANDLES 10
+#define ESP_GATT_DEF_BLE_MTU_SIZE 23
+
+typedef struct {
+  uint8_t num_attr;
+  uint16_t handles[ESP_GATT_MAX_READ_MULTI_HANDLES];
+} esp_gattc_multi_t;
+
+typedef union {
+  struct {
+    esp_gatt_status_t status;
+    uint16_t conn_id;
+    uint16_t handle;
+    uint8_t *value;
+    uint16_t value_len;
+  } read;
+  struct {
+    esp_gatt_status_t status;
+    uint16_t conn_id;
+    uint16_t handle;
+    uint16_t offset;
+  } write;
+  struct {
+    esp_gatt_status_t status;
+    uint16_t conn_id;
+    esp_bd_addr_t remote_bda;
+    uint16_t mtu;
+  } open;
+  struct {
+    esp_gatt_status_t status;
+    uint16_t conn_id;
+    esp_bd_addr_t remote_bda;
+    int reason;
+  } close;
+  struct {
+    esp_gatt_status_t status;
+    uint16_t conn_id;
+    int searched_service_source;
+  } search_cmpl;
+  struct {
+    esp_gatt_status_t status;
+    uint16_t conn_id;
+    uint16_t mtu;
+  } cfg_mtu;
+  struct {
+    uint16_t conn_id;
+    esp_bd_addr_t remote_bda;
+  } connect;
+  struct {
+    int reason;
+    uint16_t conn_id;
+    esp_bd_addr_t remote_bda;
+  } disconnect;
+} esp_ble_gattc_cb_param_t;
+
+esp_err_t esp_ble_gattc_read_char(esp_gatt_if_t gattc_if, uint16_t conn_id, uint16_t handle,
+                                  esp_gatt_auth_req_t auth_req);
+esp_err_t esp_ble_gattc_read_multiple(esp_gatt_if_t gattc_if, uint16_t conn_id, esp_gattc_multi_t *read_multi,
+                                      esp_gatt_auth_req_t auth_req);
+esp_err_t esp_ble_gattc_write_char(esp_gatt_if_t gattc_if, uint16_t conn_id, uint16_t handle, uint16_t value_len,
+                                   uint8_t *value, esp_gatt_write_type_t write_type, esp_gatt_auth_req_t auth_req);
@@ -0,0 +1,12 @@
+#pragma once
+
+// Host stand-in for the ESP-IDF heap capabilities API, backed by the host allocator statistics
+
+#include <cstddef>
+#include <cstdint>
+
+#define MALLOC_CAP_8BIT (1 << 2)
+#define MALLOC_CAP_DEFAULT (1 << 12)
+
+size_t heap_caps_get_free_size(uint32_t caps);
+size_t heap_caps_get_largest_free_block(uint32_t caps);
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <functional>
+#include <vector>
+#include "esphome/core/component.h"
+#include "esphome/core/entity_base.h"
+
+namespace esphome {
+namespace binary_sensor {
+
+class BinarySensor : public EntityBase {
+ public:
+  void publish_state(bool state);
+  void add_on_state_callback(std::function<void(bool)> &&callback) {
+    this->callbacks_.push_back(std::move(callback));
+  }
+  bool has_state() const { return this->has_state_; }
+
+  bool state{false};
+
+ protected:
+  std::vector<std::function<void(bool)>> callbacks_;
+  bool has_state_{false};
+};
+
+}  // namespace binary_sensor
+}  // namespace esphome
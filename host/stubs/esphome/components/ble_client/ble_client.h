@@ -0,0 +1,87 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <vector>
+#include <esp_gap_ble_api.h>
+#include <esp_gattc_api.h>
+#include "esphome/components/esp32_ble_tracker/esp32_ble_tracker.h"
+#include "esphome/core/component.h"
+
+namespace esphome {
+namespace ble_client {
+
+namespace espbt = esphome::esp32_ble_tracker;
+
+class BLEClient;
+
+struct BLECharacteristic {
+  espbt::ESPBTUUID service;
+  espbt::ESPBTUUID uuid;
+  uint16_t handle;
+};
+
+class BLEClientNode {
+ public:
+  virtual ~BLEClientNode() = default;
+  virtual void gattc_event_handler(esp_gattc_cb_event_t event, esp_gatt_if_t gattc_if,
+                                   esp_ble_gattc_cb_param_t *param) = 0;
+  virtual void gap_event_handler(esp_gap_ble_cb_event_t event, esp_ble_gap_cb_param_t *param) {}
+  virtual void loop() {}
+  void set_client(BLEClient *client) { this->parent_ = client; }
+  BLEClient *parent() { return this->parent_; }
+
+  espbt::ClientState node_state{espbt::ClientState::INIT};
+
+ protected:
+  BLEClient *parent_{nullptr};
+};
+
+/**
+ * Host stand-in for the ESPHome BLE client. There is no radio: whoever drives the test
+ * (see host/sim/valve_harness.h) moves it through the connection states and delivers
+ * the GATT events, which are passed on to the registered nodes like on the device.
+ */
+class BLEClient : public Component {
+ public:
+  void register_ble_node(BLEClientNode *node) {
+    node->set_client(this);
+    this->nodes_.push_back(node);
+  }
+
+  void set_address(uint64_t address);
+  uint64_t get_address() const { return this->address_; }
+  uint8_t *get_remote_bda() { return this->remote_bda_; }
+  esp_gatt_if_t get_gattc_if() const { return this->gattc_if_; }
+  uint16_t get_conn_id() const { return this->conn_id_; }
+
+  void set_enabled(bool enabled);
+  bool enabled() const { return this->enabled_; }
+
+  espbt::ClientState state() const { return this->state_; }
+  // Also the state of every node, as on the device
+  void set_state(espbt::ClientState state);
+
+  // Services discovered on the peer, looked up by get_characteristic()
+  void add_characteristic(const espbt::ESPBTUUID &service, const espbt::ESPBTUUID &chr, uint16_t handle);
+  void clear_characteristics() { this->characteristics_.clear(); }
+  BLECharacteristic *get_characteristic(const espbt::ESPBTUUID &service, const espbt::ESPBTUUID &chr);
+
+  // Updates the connection state from the event (OPEN, SEARCH_CMPL, DISCONNECT), then hands it to the nodes
+  void gattc_event_handler(esp_gattc_cb_event_t event, esp_gatt_if_t gattc_if, esp_ble_gattc_cb_param_t *param);
+  void gap_event_handler(esp_gap_ble_cb_event_t event, esp_ble_gap_cb_param_t *param);
+
+ protected:
+  std::vector<BLEClientNode *> nodes_;
+  std::deque<BLECharacteristic> characteristics_;
+  uint64_t address_{0};
+  esp_bd_addr_t remote_bda_{};
+  esp_gatt_if_t gattc_if_{3};
+  uint16_t conn_id_{0};
+  bool enabled_{true};
+  espbt::ClientState state_{espbt::ClientState::IDLE};
+};
+
+}  // namespace ble_client
+}  // namespace esphome
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <functional>
+#include <set>
+#include <vector>
+#include "esphome/core/component.h"
+#include "esphome/core/entity_base.h"
+#include "esphome/core/optional.h"
+#include "climate_mode.h"
+
+namespace esphome {
+namespace climate {
+
+class Climate;
+
+class ClimateCall {
+ public:
+  explicit ClimateCall(Climate *parent) : parent_(parent) {}
+
+  ClimateCall &set_mode(ClimateMode mode) {
+    this->mode_ = mode;
+    return *this;
+  }
+  ClimateCall &set_target_temperature(float target_temperature) {
+    this->target_temperature_ = target_temperature;
+    return *this;
+  }
+  void perform();
+
+  const optional<ClimateMode> &get_mode() const { return this->mode_; }
+  const optional<float> &get_target_temperature() const { return this->target_temperature_; }
+
+ protected:
+  Climate *const parent_;
+  optional<ClimateMode> mode_;
+  optional<float> target_temperature_;
+};
+
+class ClimateTraits {
+ public:
+  void set_supported_modes(std::set<ClimateMode> modes) { this->supported_modes_ = std::move(modes); }
+  const std::set<ClimateMode> &get_supported_modes() const { return this->supported_modes_; }
+  void set_visual_min_temperature(float visual_min_temperature) {
+    this->visual_min_temperature_ = visual_min_temperature;
+  }
+  float get_visual_min_temperature() const { return this->visual_min_temperature_; }
+  void set_visual_max_temperature(float visual_max_temperature) {
+    this->visual_max_temperature_ = visual_max_temperature;
+  }
+  float get_visual_max_temperature() const { return this->visual_max_temperature_; }
+  void set_visual_temperature_step(float temperature_step) { this->visual_temperature_step_ = temperature_step; }
+  float get_visual_temperature_step() const { return this->visual_temperature_step_; }
+
+ protected:
+  std::set<ClimateMode> supported_modes_;
+  float visual_min_temperature_{10};
+  float visual_max_temperature_{30};
+  float visual_temperature_step_{0.1};
+};
+
+class Climate : public EntityBase {
+ public:
+  ClimateCall make_call() { return ClimateCall(this); }
+  void publish_state();
+  void add_on_state_callback(std::function<void(Climate &)> &&callback) {
+    this->state_callbacks_.push_back(std::move(callback));
+  }
+
+  ClimateMode mode{CLIMATE_MODE_OFF};
+  ClimateAction action{CLIMATE_ACTION_OFF};
+  float current_temperature{0};
+  float target_temperature{0};
+
+ protected:
+  friend ClimateCall;
+
+  virtual void control(const ClimateCall &call) = 0;
+  virtual ClimateTraits traits() = 0;
+
+  std::vector<std::function<void(Climate &)>> state_callbacks_;
+};
+
+}  // namespace climate
+}  // namespace esphome
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <esp_gap_ble_api.h>
+#include <esp_gattc_api.h>
+#include "esphome/core/component.h"
+
+namespace esphome {
+namespace esp32_ble_tracker {
+
+enum class ClientState : uint8_t {
+  INIT = 0,
+  DISCONNECTING,
+  IDLE,
+  SEARCHING,
+  DISCOVERED,
+  READY_TO_CONNECT,
+  CONNECTING,
+  CONNECTED,
+  ESTABLISHED,
+};
+
+/**
+ * 16-bit or 128-bit UUID, compared on the 128-bit form like on the device
+ */
+class ESPBTUUID {
+ public:
+  static ESPBTUUID from_uint16(uint16_t uuid);
+  static ESPBTUUID from_uint32(uint32_t uuid);
+  // 16 bytes in esp_bt_uuid_t (little-endian) order
+  static ESPBTUUID from_raw(const uint8_t *data);
+  // "xxxx" or "xxxxxxxx-xxxx-xxxx-xxxx-xxxxxxxxxxxx", parsed at runtime like on the device
+  static ESPBTUUID from_raw(const std::string &data);
+
+  ESPBTUUID as_128bit() const;
+  std::string to_string() const;
+  bool operator==(const ESPBTUUID &other) const;
+  bool operator!=(const ESPBTUUID &other) const { return !(*this == other); }
+
+ protected:
+  uint8_t len_{0};  // 2, 4 or 16
+  uint8_t uuid_[16]{};
+};
+
+/**
+ * Advertisement as seen by the tracker. On the host it is filled in directly, instead of
+ * being parsed from a scan result.
+ */
+class ESPBTDevice {
+ public:
+  ESPBTDevice() = default;
+  ESPBTDevice(uint64_t address, std::string name, int rssi) : address_(address), name_(std::move(name)), rssi_(rssi) {}
+
+  uint64_t address_uint64() const { return this->address_; }
+  std::string address_str() const;
+  int get_rssi() const { return this->rssi_; }
+  const std::string &get_name() const { return this->name_; }
+
+ protected:
+  uint64_t address_{0};
+  std::string name_;
+  int rssi_{0};
+};
+
+class ESPBTDeviceListener {
+ public:
+  virtual ~ESPBTDeviceListener() = default;
+  virtual bool parse_device(const ESPBTDevice &device) = 0;
+};
+
+}  // namespace esp32_ble_tracker
+}  // namespace esphome
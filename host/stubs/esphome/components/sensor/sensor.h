@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cmath>
+#include <functional>
+#include <vector>
+#include "esphome/core/component.h"
+#include "esphome/core/entity_base.h"
+
+namespace esphome {
+namespace sensor {
+
+class Sensor : public EntityBase {
+ public:
+  void publish_state(float state);
+  void add_on_state_callback(std::function<void(float)> &&callback) {
+    this->callbacks_.push_back(std::move(callback));
+  }
+  bool has_state() const { return this->has_state_; }
+
+  float state{NAN};
+
+ protected:
+  std::vector<std::function<void(float)>> callbacks_;
+  bool has_state_{false};
+};
+
+}  // namespace sensor
+}  // namespace esphome
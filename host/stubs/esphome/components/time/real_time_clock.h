@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstdint>
+#include <ctime>
+#include "esphome/core/component.h"
+
+namespace esphome {
+
+struct ESPTime {
+  time_t timestamp{0};
+
+  // Same rule as ESPHome: anything before 2019 means the time was never synchronized
+  bool is_valid() const { return this->timestamp >= 1546300800; }
+  // Seconds east of UTC of the local timezone (see host::set_timezone_offset)
+  static int32_t timezone_offset();
+};
+
+namespace time {
+
+/**
+ * Host time source: runs from the epoch set with set_epoch_time(), advancing with millis().
+ */
+class RealTimeClock : public PollingComponent {
+ public:
+  ESPTime now();
+  ESPTime utcnow() { return this->now(); }
+  void update() override {}
+
+  void set_epoch_time(uint32_t epoch);
+
+ protected:
+  uint32_t epoch_{0};
+  uint32_t epoch_at_{0};
+};
+
+}  // namespace time
+}  // namespace esphome
@@ -0,0 +1,11 @@
+#pragma once
+
+namespace esphome {
+
+template<typename... Ts> class Action {
+ public:
+  virtual ~Action() = default;
+  virtual void play(Ts... x) = 0;
+};
+
+}  // namespace esphome
@@ -0,0 +1,5 @@
+#pragma once
+
+// Host build: the integrations the component is compiled against on the device
+#define USE_TIME
+#define USE_DANFOSS_ECO_SCANNER
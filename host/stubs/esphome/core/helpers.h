@@ -0,0 +1,17 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include "esphome/core/hal.h"
+#include "esphome/core/optional.h"
+
+namespace esphome {
+
+uint32_t fnv1_hash(const std::string &str);
+std::string str_sprintf(const char *fmt, ...) __attribute__((format(printf, 1, 2)));
+std::string format_hex_pretty(const uint8_t *data, size_t length);
+
+template<typename T> T clamp(T v, T lo, T hi) { return v < lo ? lo : (v > hi ? hi : v); }
+
+}  // namespace esphome
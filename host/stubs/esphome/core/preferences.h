@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace esphome {
+
+/**
+ * Host preferences live in memory (see host::clear_preferences), keyed by the type hash
+ * like flash entries on the device.
+ */
+class ESPPreferenceObject {
+ public:
+  ESPPreferenceObject() = default;
+  ESPPreferenceObject(uint32_t type, size_t length) : type_(type), length_(length), valid_(true) {}
+
+  template<typename T> bool save(const T *src) { return this->save_(src, sizeof(T)); }
+  template<typename T> bool load(T *dest) { return this->load_(dest, sizeof(T)); }
+
+ protected:
+  bool save_(const void *data, size_t length);
+  bool load_(void *data, size_t length);
+
+  uint32_t type_{0};
+  size_t length_{0};
+  bool valid_{false};
+};
+
+class ESPPreferences {
+ public:
+  template<typename T> ESPPreferenceObject make_preference(uint32_t type, bool in_flash) {
+    return ESPPreferenceObject(type, sizeof(T));
+  }
+  template<typename T> ESPPreferenceObject make_preference(uint32_t type) {
+    return ESPPreferenceObject(type, sizeof(T));
+  }
+  bool sync() { return true; }
+};
+
+extern ESPPreferences *global_preferences;
+
+}  // namespace esphome
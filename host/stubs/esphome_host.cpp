@@ -0,0 +1,365 @@
+// Implementations of the host stand-ins for ESPHome and ESP-IDF
+
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <string>
+#include <vector>
+#include <malloc.h>
+#include <esp_heap_caps.h>
+#include "esphome/components/binary_sensor/binary_sensor.h"
+#include "esphome/components/ble_client/ble_client.h"
+#include "esphome/components/climate/climate.h"
+#include "esphome/components/sensor/sensor.h"
+#include "esphome/components/time/real_time_clock.h"
+#include "esphome/core/hal.h"
+#include "esphome/core/helpers.h"
+#include "esphome/core/log.h"
+#include "esphome/core/preferences.h"
+#include "host_support.h"
+
+namespace esphome {
+
+static uint32_t now_ms = 0;
+static int32_t timezone_offset_s = 0;
+static host::GattServer *gatt_server = nullptr;
+static std::string *log_capture = nullptr;
+
+static std::map<uint32_t, std::vector<uint8_t>> &preference_store() {
+  static std::map<uint32_t, std::vector<uint8_t>> store;
+  return store;
+}
+
+static int initial_log_level() {
+  const char *level = getenv("DANFOSS_ECO_HOST_LOG_LEVEL");
+  return level != nullptr ? atoi(level) : ESPHOME_LOG_LEVEL_NONE;
+}
+
+int host_log_level = initial_log_level();
+
+namespace host {
+
+void set_millis(uint32_t ms) { now_ms = ms; }
+void advance_millis(uint32_t ms) { now_ms += ms; }
+void set_log_level(int level) { host_log_level = level; }
+void set_log_capture(std::string *out) { log_capture = out; }
+void clear_preferences() { preference_store().clear(); }
+void set_timezone_offset(int32_t offset) { timezone_offset_s = offset; }
+void set_gatt_server(GattServer *server) { gatt_server = server; }
+
+}  // namespace host
+
+uint32_t millis() { return now_ms; }
+uint32_t micros() { return now_ms * 1000; }
+void delay(uint32_t ms) { now_ms += ms; }
+
+void esp_log_printf_(int level, const char *tag, int line, const char *format, ...) {
+  static const char LEVELS[] = "NEWICDVV";
+  va_list args;
+  va_start(args, format);
+  if (log_capture != nullptr) {
+    char buf[512];
+    int n = snprintf(buf, sizeof(buf), "[%8u][%c][%s:%d]: ", now_ms, LEVELS[level], tag, line);
+    vsnprintf(buf + n, sizeof(buf) - n, format, args);
+    *log_capture += buf;
+    *log_capture += '\n';
+  } else {
+    fprintf(stderr, "[%8u][%c][%s:%d]: ", now_ms, LEVELS[level], tag, line);
+    vfprintf(stderr, format, args);
+    fputc('\n', stderr);
+  }
+  va_end(args);
+}
+
+uint32_t fnv1_hash(const std::string &str) {
+  uint32_t hash = 2166136261UL;
+  for (char c : str) {
+    hash *= 16777619UL;
+    hash ^= c;
+  }
+  return hash;
+}
+
+std::string str_sprintf(const char *fmt, ...) {
+  std::string str;
+  va_list args;
+  va_start(args, fmt);
+  size_t length = vsnprintf(nullptr, 0, fmt, args);
+  va_end(args);
+  str.resize(length);
+  va_start(args, fmt);
+  vsnprintf(&str[0], length + 1, fmt, args);
+  va_end(args);
+  return str;
+}
+
+std::string format_hex_pretty(const uint8_t *data, size_t length) {
+  std::string ret;
+  char buf[4];
+  for (size_t i = 0; i < length; i++) {
+    snprintf(buf, sizeof(buf), i + 1 < length ? "%02X." : "%02X", data[i]);
+    ret += buf;
+  }
+  return ret;
+}
+
+static ESPPreferences preferences;
+ESPPreferences *global_preferences = &preferences;
+
+bool ESPPreferenceObject::save_(const void *data, size_t length) {
+  if (!this->valid_ || length != this->length_) return false;
+  auto *bytes = static_cast<const uint8_t *>(data);
+  preference_store()[this->type_].assign(bytes, bytes + length);
+  return true;
+}
+
+bool ESPPreferenceObject::load_(void *data, size_t length) {
+  if (!this->valid_) return false;
+  auto it = preference_store().find(this->type_);
+  if (it == preference_store().end() || it->second.size() != length) return false;
+  memcpy(data, it->second.data(), length);
+  return true;
+}
+
+int32_t ESPTime::timezone_offset() { return timezone_offset_s; }
+
+namespace time {
+
+ESPTime RealTimeClock::now() {
+  ESPTime time;
+  if (this->epoch_ != 0) time.timestamp = this->epoch_ + (millis() - this->epoch_at_) / 1000;
+  return time;
+}
+
+void RealTimeClock::set_epoch_time(uint32_t epoch) {
+  this->epoch_ = epoch;
+  this->epoch_at_ = millis();
+}
+
+}  // namespace time
+
+namespace sensor {
+
+void Sensor::publish_state(float state) {
+  this->state = state;
+  this->has_state_ = true;
+  for (auto &callback : this->callbacks_) callback(state);
+}
+
+}  // namespace sensor
+
+namespace binary_sensor {
+
+void BinarySensor::publish_state(bool state) {
+  this->state = state;
+  this->has_state_ = true;
+  for (auto &callback : this->callbacks_) callback(state);
+}
+
+}  // namespace binary_sensor
+
+namespace climate {
+
+void ClimateCall::perform() { this->parent_->control(*this); }
+
+void Climate::publish_state() {
+  for (auto &callback : this->state_callbacks_) callback(*this);
+}
+
+const char *climate_mode_to_string(ClimateMode mode) {
+  switch (mode) {
+    case CLIMATE_MODE_OFF:
+      return "OFF";
+    case CLIMATE_MODE_HEAT_COOL:
+      return "HEAT_COOL";
+    case CLIMATE_MODE_COOL:
+      return "COOL";
+    case CLIMATE_MODE_HEAT:
+      return "HEAT";
+    case CLIMATE_MODE_FAN_ONLY:
+      return "FAN_ONLY";
+    case CLIMATE_MODE_DRY:
+      return "DRY";
+    case CLIMATE_MODE_AUTO:
+      return "AUTO";
+    default:
+      return "UNKNOWN";
+  }
+}
+
+}  // namespace climate
+
+namespace esp32_ble_tracker {
+
+// Bluetooth base UUID (0000xxxx-0000-1000-8000-00805f9b34fb), little-endian
+static const uint8_t BT_BASE_UUID[16] = {0xfb, 0x34, 0x9b, 0x5f, 0x80, 0x00, 0x00, 0x80,
+                                         0x00, 0x10, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00};
+
+ESPBTUUID ESPBTUUID::from_uint16(uint16_t uuid) {
+  ESPBTUUID ret;
+  ret.len_ = 2;
+  ret.uuid_[0] = uuid & 0xFF;
+  ret.uuid_[1] = uuid >> 8;
+  return ret;
+}
+
+ESPBTUUID ESPBTUUID::from_uint32(uint32_t uuid) {
+  ESPBTUUID ret;
+  ret.len_ = 4;
+  for (uint8_t i = 0; i < 4; i++)
+    ret.uuid_[i] = (uuid >> (i * 8)) & 0xFF;
+  return ret;
+}
+
+ESPBTUUID ESPBTUUID::from_raw(const uint8_t *data) {
+  ESPBTUUID ret;
+  ret.len_ = 16;
+  memcpy(ret.uuid_, data, 16);
+  return ret;
+}
+
+ESPBTUUID ESPBTUUID::from_raw(const std::string &data) {
+  ESPBTUUID ret;
+  if (data.length() == 4) {
+    return from_uint16((uint16_t) strtoul(data.c_str(), nullptr, 16));
+  }
+  ret.len_ = 16;
+  // Most significant digits first in the string, least significant byte first in uuid_
+  uint8_t n = 0;
+  for (size_t i = data.length(); i >= 2 && n < 16; i--) {
+    if (data[i - 1] == '-') continue;
+    char hex[3] = {data[i - 2], data[i - 1], '\0'};
+    ret.uuid_[n++] = (uint8_t) strtoul(hex, nullptr, 16);
+    i--;
+  }
+  return ret;
+}
+
+ESPBTUUID ESPBTUUID::as_128bit() const {
+  if (this->len_ == 16) return *this;
+  ESPBTUUID ret;
+  ret.len_ = 16;
+  memcpy(ret.uuid_, BT_BASE_UUID, 16);
+  memcpy(ret.uuid_ + 12, this->uuid_, this->len_);
+  return ret;
+}
+
+bool ESPBTUUID::operator==(const ESPBTUUID &other) const {
+  if (this->len_ == other.len_) return memcmp(this->uuid_, other.uuid_, this->len_) == 0;
+  return this->as_128bit() == other.as_128bit();
+}
+
+std::string ESPBTUUID::to_string() const {
+  if (this->len_ == 2) return str_sprintf("0x%02X%02X", this->uuid_[1], this->uuid_[0]);
+  if (this->len_ == 4)
+    return str_sprintf("0x%02X%02X%02X%02X", this->uuid_[3], this->uuid_[2], this->uuid_[1], this->uuid_[0]);
+  std::string ret;
+  for (int8_t i = 15; i >= 0; i--) {
+    ret += str_sprintf("%02X", this->uuid_[i]);
+    if (i == 12 || i == 10 || i == 8 || i == 6) ret += "-";
+  }
+  return ret;
+}
+
+std::string ESPBTDevice::address_str() const {
+  return str_sprintf("%02X:%02X:%02X:%02X:%02X:%02X", (unsigned) (this->address_ >> 40) & 0xFF,
+                     (unsigned) (this->address_ >> 32) & 0xFF, (unsigned) (this->address_ >> 24) & 0xFF,
+                     (unsigned) (this->address_ >> 16) & 0xFF, (unsigned) (this->address_ >> 8) & 0xFF,
+                     (unsigned) this->address_ & 0xFF);
+}
+
+}  // namespace esp32_ble_tracker
+
+namespace ble_client {
+
+void BLEClient::set_address(uint64_t address) {
+  this->address_ = address;
+  for (int i = 0; i < 6; i++) {
+    this->remote_bda_[i] = (address >> (40 - i * 8)) & 0xFF;
+  }
+}
+
+void BLEClient::set_enabled(bool enabled) {
+  if (enabled == this->enabled_) return;
+  this->enabled_ = enabled;
+  if (!enabled) this->set_state(espbt::ClientState::IDLE);
+}
+
+void BLEClient::set_state(espbt::ClientState state) {
+  this->state_ = state;
+  for (auto *node : this->nodes_) node->node_state = state;
+}
+
+void BLEClient::add_characteristic(const espbt::ESPBTUUID &service, const espbt::ESPBTUUID &chr, uint16_t handle) {
+  this->characteristics_.push_back({service, chr, handle});
+}
+
+BLECharacteristic *BLEClient::get_characteristic(const espbt::ESPBTUUID &service, const espbt::ESPBTUUID &chr) {
+  for (auto &c : this->characteristics_) {
+    if (c.service == service && c.uuid == chr) return &c;
+  }
+  return nullptr;
+}
+
+void BLEClient::gattc_event_handler(esp_gattc_cb_event_t event, esp_gatt_if_t gattc_if,
+                                    esp_ble_gattc_cb_param_t *param) {
+  switch (event) {
+    case ESP_GATTC_OPEN_EVT:
+      if (param->open.status == ESP_GATT_OK) {
+        this->conn_id_ = param->open.conn_id;
+        this->set_state(espbt::ClientState::CONNECTED);
+      } else {
+        this->set_state(espbt::ClientState::IDLE);
+      }
+      break;
+    case ESP_GATTC_SEARCH_CMPL_EVT:
+      this->set_state(espbt::ClientState::ESTABLISHED);
+      break;
+    case ESP_GATTC_DISCONNECT_EVT:
+      this->set_state(espbt::ClientState::IDLE);
+      break;
+    default:
+      break;
+  }
+  for (auto *node : this->nodes_) node->gattc_event_handler(event, gattc_if, param);
+}
+
+void BLEClient::gap_event_handler(esp_gap_ble_cb_event_t event, esp_ble_gap_cb_param_t *param) {
+  for (auto *node : this->nodes_) node->gap_event_handler(event, param);
+}
+
+}  // namespace ble_client
+}  // namespace esphome
+
+using esphome::gatt_server;
+
+esp_err_t esp_ble_gattc_read_char(esp_gatt_if_t gattc_if, uint16_t conn_id, uint16_t handle,
+                                  esp_gatt_auth_req_t auth_req) {
+  return gatt_server != nullptr ? gatt_server->read_char(handle) : ESP_FAIL;
+}
+
+esp_err_t esp_ble_gattc_read_multiple(esp_gatt_if_t gattc_if, uint16_t conn_id, esp_gattc_multi_t *read_multi,
+                                      esp_gatt_auth_req_t auth_req) {
+  return gatt_server != nullptr ? gatt_server->read_multiple(*read_multi) : ESP_FAIL;
+}
+
+esp_err_t esp_ble_gattc_write_char(esp_gatt_if_t gattc_if, uint16_t conn_id, uint16_t handle, uint16_t value_len,
+                                   uint8_t *value, esp_gatt_write_type_t write_type, esp_gatt_auth_req_t auth_req) {
+  return gatt_server != nullptr ? gatt_server->write_char(handle, value, value_len) : ESP_FAIL;
+}
+
+esp_err_t esp_ble_gap_update_conn_params(esp_ble_conn_update_params_t *params) {
+  return gatt_server != nullptr ? gatt_server->update_conn_params(*params) : ESP_FAIL;
+}
+
+size_t heap_caps_get_free_size(uint32_t caps) {
+  struct mallinfo2 info = mallinfo2();
+  return info.fordblks;
+}
+
+size_t heap_caps_get_largest_free_block(uint32_t caps) {
+  struct mallinfo2 info = mallinfo2();
+  return info.fordblks;
+}
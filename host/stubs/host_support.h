@@ -0,0 +1,44 @@
+#pragma once
+
+// Controls for the host stand-ins, used by the simulator, tests and benchmarks only
+
+#include <cstdint>
+#include <string>
+#include <esp_gap_ble_api.h>
+#include <esp_gattc_api.h>
+
+namespace esphome {
+namespace host {
+
+// Simulated clock returned by millis()/micros()
+void set_millis(uint32_t ms);
+void advance_millis(uint32_t ms);
+
+// ESPHOME_LOG_LEVEL_*, the initial level is read from DANFOSS_ECO_HOST_LOG_LEVEL (default: none)
+void set_log_level(int level);
+// While set, log lines are appended to `out` (one per line) instead of printed; nullptr restores printing
+void set_log_capture(std::string *out);
+
+// Drops everything saved through global_preferences, as if the flash was erased
+void clear_preferences();
+
+void set_timezone_offset(int32_t offset);
+
+/**
+ * Receives the requests the component makes through esp_ble_gattc_* / esp_ble_gap_*.
+ * Returning something other than ESP_OK is the stack rejecting the request.
+ */
+class GattServer {
+ public:
+  virtual ~GattServer() = default;
+  virtual esp_err_t read_char(uint16_t handle) = 0;
+  virtual esp_err_t read_multiple(const esp_gattc_multi_t &multi) = 0;
+  virtual esp_err_t write_char(uint16_t handle, const uint8_t *value, uint16_t value_len) = 0;
+  virtual esp_err_t update_conn_params(const esp_ble_conn_update_params_t &params) { return ESP_OK; }
+};
+
+// Without a server every request is rejected
+void set_gatt_server(GattServer *server);
+
+}  // namespace host
+}  // namespace esphome
@@ -0,0 +1,77 @@
+// Property updates decode into storage owned by the property, so the BLE event path doesn't allocate
+
+#include <gtest/gtest.h>
+#include <cstdlib>
+#include <new>
+#include "valve_harness.h"
+
+// Counts every allocation made through operator new in this test binary
+static size_t allocations = 0;
+
+void *operator new(std::size_t size) {
+  allocations++;
+  void *p = std::malloc(size != 0 ? size : 1);
+  if (p == nullptr) throw std::bad_alloc();
+  return p;
+}
+void *operator new[](std::size_t size) { return operator new(size); }
+void operator delete(void *p) noexcept { std::free(p); }
+void operator delete[](void *p) noexcept { std::free(p); }
+void operator delete(void *p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void *p, std::size_t) noexcept { std::free(p); }
+
+namespace esphome {
+namespace danfoss_eco {
+namespace sim {
+
+static const uint32_t UPDATES = 1000000;
+
+TEST(AllocTest, MillionPropertyUpdatesDontAllocate) {
+  ValveHarness h;
+  h.setup();
+  auto xxtea = std::make_shared<Xxtea>();
+  uint8_t key[16] = {0x00, 0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77, 0x88, 0x99, 0xaa, 0xbb, 0xcc, 0xdd, 0xee, 0xff};
+  xxtea->set_key(key, sizeof(key));
+  TemperatureProperty temperature(&h.component, xxtea);
+  SettingsProperty settings(&h.component, xxtea);
+  ErrorsProperty errors(&h.component, xxtea);
+
+  // Two different values per property, alternated so every update is decrypted, decoded and published
+  uint8_t temperature_values[2][8], settings_values[2][16], errors_values[2][8];
+  for (uint8_t i = 0; i < 2; i++) {
+    uint8_t plain[16] = {(uint8_t) (38 + i), 42, 0, 10, 56};
+    xxtea->encrypt(plain, 8, temperature_values[i]);
+    plain[0] = i;
+    xxtea->encrypt(plain, 16, settings_values[i]);
+    uint8_t flags[8] = {0, i};
+    xxtea->encrypt(flags, 8, errors_values[i]);
+  }
+
+  uint32_t publishes = h.climate_publishes;
+  size_t before = allocations;
+  ASSERT_GT(before, 0u) << "operator new is not counted";
+  for (uint32_t n = 0; n < UPDATES; n++) {
+    uint8_t i = n & 1;
+    switch (n % 3) {
+      case 0:
+        temperature.update_state(temperature_values[i], 8);
+        break;
+      case 1:
+        settings.update_state(settings_values[i], 16);
+        break;
+      default:
+        errors.update_state(errors_values[i], 8);
+        break;
+    }
+  }
+  EXPECT_EQ(allocations - before, 0u);
+
+  // The updates did go all the way through
+  EXPECT_GT(h.climate_publishes - publishes, UPDATES / 2);
+  EXPECT_EQ(temperature.decrypts_skipped + settings.decrypts_skipped + errors.decrypts_skipped, 0u);
+  EXPECT_TRUE(h.problems.has_state());
+}
+
+}  // namespace sim
+}  // namespace danfoss_eco
+}  // namespace esphome
@@ -0,0 +1,62 @@
+// Valve clock check and sync against a time source
+
+#include <gtest/gtest.h>
+#include "esphome/components/time/real_time_clock.h"
+#include "valve_harness.h"
+
+namespace esphome {
+namespace danfoss_eco {
+namespace sim {
+
+static const uint32_t EPOCH = 1760000000;
+
+// Older firmware has no clock characteristic: nothing is sent to it, even with E10 raised
+TEST(ClockTest, NoRequestsWithoutClockCharacteristic) {
+  ValveConfig config;
+  config.current_time = false;
+  ValveHarness h(config);
+  h.valve.errors[0] = 0x02;
+  time::RealTimeClock clock;
+  clock.set_epoch_time(EPOCH);
+  h.setup([&](MyComponent &c) { c.set_time(&clock); });
+
+  ASSERT_TRUE(h.run_until_established());
+  ASSERT_TRUE(h.run_until([&]() { return h.problems.has_state(); }, 2000));
+  h.run_for(30 * 60 * 1000);
+
+  EXPECT_EQ(h.valve.invalid_handles, 0u);
+  EXPECT_EQ(h.valve.time_local, 0u);
+}
+
+// A clock read which keeps failing is retried as a command, not queued again on every poll
+TEST(ClockTest, FailingReadIsNotRequeuedEveryPoll) {
+  ValveHarness h;
+  time::RealTimeClock clock;
+  clock.set_epoch_time(EPOCH);
+  h.valve.fail_handle = h.valve.handle(CharacteristicId::CURRENT_TIME);
+  h.setup([&](MyComponent &c) { c.set_time(&clock); });
+
+  ASSERT_TRUE(h.run_until_established());
+  ASSERT_TRUE(h.run_until([&]() { return h.valve.failed_handle_requests > 0; }, 5000));
+  h.run_for(60 * 1000);
+  uint32_t failed = h.valve.failed_handle_requests;
+  h.run_for(30 * 60 * 1000);
+
+  EXPECT_EQ(h.valve.failed_handle_requests, failed);
+}
+
+TEST(ClockTest, DriftedClockIsSet) {
+  ValveHarness h;
+  h.valve.time_local = EPOCH - 3600;
+  time::RealTimeClock clock;
+  clock.set_epoch_time(EPOCH);
+  h.setup([&](MyComponent &c) { c.set_time(&clock); });
+
+  ASSERT_TRUE(h.run_until_established());
+  ASSERT_TRUE(h.run_until([&]() { return h.valve.time_local > EPOCH - 60; }, 5000));
+  EXPECT_EQ(h.valve.invalid_handles, 0u);
+}
+
+}  // namespace sim
+}  // namespace danfoss_eco
+}  // namespace esphome
@@ -0,0 +1,210 @@
+#include <gtest/gtest.h>
+#include "host_support.h"
+#include "valve_harness.h"
+
+namespace esphome {
+namespace danfoss_eco {
+namespace sim {
+
+TEST(DeviceTest, FirstPollPublishesValveState) {
+  ValveHarness h;
+  h.valve.room_temperature = 19.5f;
+  h.valve.target_temperature = 22.0f;
+  h.valve.mode = 1;
+  h.valve.battery_level = 64;
+  h.setup();
+
+  ASSERT_TRUE(h.run_until_established());
+  ASSERT_TRUE(h.run_until([&]() { return h.temperature.has_state() && h.battery.has_state(); }, 2000));
+  h.run_for(500);
+
+  EXPECT_FLOAT_EQ(h.temperature.state, 19.5f);
+  EXPECT_FLOAT_EQ(h.component.current_temperature, 19.5f);
+  EXPECT_FLOAT_EQ(h.component.target_temperature, 22.0f);
+  EXPECT_EQ(h.component.mode, climate::CLIMATE_MODE_AUTO);
+  EXPECT_FLOAT_EQ(h.battery.state, 64.0f);
+  EXPECT_TRUE(h.problems.has_state());
+  EXPECT_FALSE(h.problems.state);
+}
+
+TEST(DeviceTest, RefreshIsBatchedIntoReadMultiple) {
+  ValveHarness h;
+  h.setup();
+  ASSERT_TRUE(h.run_until_established());
+  h.run_for(1000);
+
+  EXPECT_GE(h.valve.read_multiples, 1u);
+  EXPECT_TRUE(h.temperature.has_state());
+}
+
+TEST(DeviceTest, SetpointIsWrittenToTheValve) {
+  ValveHarness h;
+  h.setup();
+  ASSERT_TRUE(h.run_until_established());
+  h.run_for(1000);
+
+  h.component.make_call().set_target_temperature(23.5f).perform();
+  EXPECT_FLOAT_EQ(h.component.target_temperature, 23.5f);
+  ASSERT_TRUE(h.run_until([&]() { return h.valve.target_temperature == 23.5f; }, 1000));
+}
+
+TEST(DeviceTest, UserWriteSurvivesDroppedLink) {
+  ValveHarness h;
+  h.setup();
+  ASSERT_TRUE(h.run_until_established());
+  h.run_for(1000);
+
+  h.drop_link();
+  h.component.make_call().set_target_temperature(17.0f).perform();
+  h.run_for(10);
+  EXPECT_FALSE(h.established());
+
+  // Sent once the client has reconnected on its own
+  ASSERT_TRUE(h.run_until([&]() { return h.valve.target_temperature == 17.0f; }, 5000));
+}
+
+TEST(DeviceTest, UserWriteOvertakesContinuousPolling) {
+  ValveHarness h;
+  h.setup([](MyComponent &c) { c.set_read_multiple(false); });
+  h.poll_load_ms = 1;
+  ASSERT_TRUE(h.run_until_established());
+  h.run_for(1000);
+
+  // Only the read on the air is waited for, not the refresh queued behind it: two round trips at most
+  for (uint32_t i = 0; i < 20; i++) {
+    h.run_for(1 + i * 13);
+    uint32_t acks = h.valve.write_acks;
+    uint32_t reads = h.valve.reads;
+    uint32_t start = millis();
+    h.component.make_call().set_target_temperature(i & 1 ? 22.5f : 22.0f).perform();
+    ASSERT_TRUE(h.run_until([&]() { return h.valve.write_acks != acks; }, 5000));
+    EXPECT_LE(h.valve.last_write_ack_at - start, 2 * h.valve.config().latency_ms + 2) << "write " << i;
+    EXPECT_LE(h.valve.reads - reads, 1u) << "write " << i;
+  }
+  // Polling wasn't starved by the writes
+  uint32_t reads = h.valve.reads;
+  h.run_for(1000);
+  EXPECT_GE(h.valve.reads - reads, 15u);
+}
+
+TEST(DeviceTest, PinWriteIsNotAUserWrite) {
+  ValveConfig config;
+  config.pin = 1234;
+  ValveHarness h(config);
+  sensor::Sensor write_ack;
+  h.setup([&](MyComponent &c) {
+    c.set_pin_code("1234");
+    c.set_latency_sensor(LatencyStage::WRITE_ACK, LatencyStat::MAX, &write_ack);
+  });
+  ASSERT_TRUE(h.run_until_established());
+  h.run_for(2000);
+  h.drop_link();
+  h.run_for(10);
+  ASSERT_TRUE(h.run_until_established());
+  h.run_for(2000);
+
+  // Two sessions, each starting with the PIN, and no user changes: nothing to report
+  EXPECT_EQ(h.valve.writes, 2u);
+  EXPECT_TRUE(h.temperature.has_state());
+  EXPECT_FALSE(write_ack.has_state());
+
+  h.component.make_call().set_target_temperature(23.0f).perform();
+  ASSERT_TRUE(h.run_until([&]() { return write_ack.has_state(); }, 2000));
+  EXPECT_LE(write_ack.state, 2 * h.valve.config().latency_ms + 2);
+}
+
+TEST(DeviceTest, WritesWaitForDiscoveryToConfirmCachedHandles) {
+  ValveHarness h;
+  h.setup();
+  ASSERT_TRUE(h.run_until_established());
+  h.run_for(1000);
+
+  // Layout shifted by one characteristic while disconnected: the cached temperature handle is now
+  // the valve's clock, which a setpoint sent before discovery would overwrite
+  h.drop_link();
+  uint16_t cached = h.valve.handle(CharacteristicId::TEMPERATURE);
+  uint16_t stride = h.valve.handle(CharacteristicId::SETTINGS) - h.valve.handle(CharacteristicId::PIN);
+  h.valve.set_handle_base(h.valve.handle(CharacteristicId::PIN) - stride);
+  ASSERT_EQ(h.valve.handle(CharacteristicId::CURRENT_TIME), cached);
+  h.valve.config().discovery_ms = 3000;
+  h.valve.time_local = 12345;
+  h.component.make_call().set_target_temperature(24.0f).perform();
+
+  ASSERT_TRUE(h.run_until([&]() { return h.valve.target_temperature == 24.0f; }, 10000));
+  EXPECT_EQ(h.valve.time_local, 12345u);
+}
+
+TEST(DeviceTest, SendsCommandsOncePastHalfTheMillisRange) {
+  ValveHarness h;
+  h.setup();
+  ASSERT_TRUE(h.run_until_established());
+  h.run_for(1000);
+
+  host::set_millis(millis() + 0x80000000u);
+  h.component.make_call().set_target_temperature(24.0f).perform();
+  ASSERT_TRUE(h.run_until([&]() { return h.valve.target_temperature == 24.0f; }, 1000));
+}
+
+// State restored after a reboot stays marked stale until every part has been decoded from the valve
+TEST(DeviceTest, RejectedReadKeepsRestoredStateStale) {
+  {
+    ValveHarness h;
+    h.setup();
+    ASSERT_TRUE(h.run_until_established());
+    h.run_for(3000);
+    h.component.on_safe_shutdown();
+  }
+
+  ValveHarness h(ValveConfig{}, true);
+  h.setup();
+  ASSERT_TRUE(h.stale.has_state());
+  EXPECT_TRUE(h.stale.state);
+
+  // Settings are read on their own and come back cut short, the batched values decode fine
+  h.valve.truncate_next = 255;
+  ASSERT_TRUE(h.run_until_established());
+  ASSERT_TRUE(h.run_until([&]() { return h.temperature.has_state(); }, 2000));
+  h.run_for(3000);
+  EXPECT_TRUE(h.stale.state);
+
+  h.valve.truncate_next = 0;
+  EXPECT_TRUE(h.run_until([&]() { return !h.stale.state; }, 10 * 60 * 1000));
+}
+
+TEST(DeviceTest, RecoversFromInjectedFailures) {
+  ValveConfig config;
+  config.seed = 7;
+  config.error_rate = 0.2f;
+  config.reject_rate = 0.1f;
+  config.jitter_ms = 40;
+  ValveHarness h(config);
+  h.setup();
+
+  ASSERT_TRUE(h.run_until_established());
+  ASSERT_TRUE(h.run_until([&]() { return h.temperature.has_state() && h.battery.has_state(); }, 20000));
+}
+
+TEST(DeviceTest, RunsAreDeterministic) {
+  ValveConfig config;
+  config.seed = 42;
+  config.error_rate = 0.1f;
+  config.drop_rate = 0.05f;
+  config.jitter_ms = 30;
+
+  uint32_t counts[2][3];
+  for (auto &count : counts) {
+    ValveHarness h(config);
+    h.setup();
+    h.run_for(5 * 60 * 1000);
+    count[0] = h.valve.reads;
+    count[1] = h.valve.read_multiples;
+    count[2] = h.climate_publishes;
+  }
+  EXPECT_EQ(counts[0][0], counts[1][0]);
+  EXPECT_EQ(counts[0][1], counts[1][1]);
+  EXPECT_EQ(counts[0][2], counts[1][2]);
+}
+
+}  // namespace sim
+}  // namespace danfoss_eco
+}  // namespace esphome
@@ -0,0 +1,39 @@
+#include <gtest/gtest.h>
+#include "host_support.h"
+#include "valve_harness.h"
+
+namespace esphome {
+namespace danfoss_eco {
+namespace sim {
+
+TEST(PollingTest, PollsOnInterval) {
+  ValveHarness h;
+  h.setup([](MyComponent &c) { c.set_update_interval(30000); });
+  ASSERT_TRUE(h.run_until_established());
+  h.run_for(1000);
+  uint32_t read_multiples = h.valve.read_multiples;
+
+  h.run_for(28000);
+  EXPECT_EQ(h.valve.read_multiples, read_multiples);
+  h.run_for(2000);
+  EXPECT_EQ(h.valve.read_multiples, read_multiples + 1);
+}
+
+TEST(PollingTest, KeepsPollingOncePastHalfTheMillisRange) {
+  ValveHarness h;
+  h.setup([](MyComponent &c) { c.set_update_interval(30000); });
+  ASSERT_TRUE(h.run_until_established());
+  h.run_for(1000);
+
+  // (int32_t) (millis() - first_poll_at_) turns negative 24.8 days after the stagger point
+  host::set_millis(millis() + 0x80000000u);
+  uint32_t read_multiples = h.valve.read_multiples;
+  h.run_for(1000);
+  EXPECT_EQ(h.valve.read_multiples, read_multiples + 1);
+  h.run_for(30000);
+  EXPECT_EQ(h.valve.read_multiples, read_multiples + 2);
+}
+
+}  // namespace sim
+}  // namespace danfoss_eco
+}  // namespace esphome
@@ -0,0 +1,117 @@
+#include <gtest/gtest.h>
+#include "valve_harness.h"
+
+namespace esphome {
+namespace danfoss_eco {
+namespace sim {
+
+static void poll(ValveHarness &h) {
+  h.component.update();
+  h.run_for(1000);
+}
+
+TEST(ReadMultipleTest, FallsBackWhenNotSupported) {
+  ValveConfig config;
+  config.read_multiple = false;
+  ValveHarness h(config);
+  h.setup();
+  ASSERT_TRUE(h.run_until_established());
+  h.run_for(1000);
+
+  EXPECT_EQ(h.valve.read_multiples, 1u);
+  EXPECT_TRUE(h.temperature.has_state());
+  EXPECT_TRUE(h.battery.has_state());
+
+  uint32_t reads = h.valve.reads;
+  poll(h);
+  EXPECT_EQ(h.valve.read_multiples, 1u);
+  EXPECT_GT(h.valve.reads, reads);
+}
+
+// Requests made by one poll, settings don't fit into the batch with the default MTU
+struct PollRequests {
+  uint32_t read_multiples;
+  uint32_t reads;
+};
+
+static PollRequests poll_counted(ValveHarness &h) {
+  uint32_t read_multiples = h.valve.read_multiples;
+  uint32_t reads = h.valve.reads;
+  poll(h);
+  return {h.valve.read_multiples - read_multiples, h.valve.reads - reads};
+}
+
+TEST(ReadMultipleTest, ErrorResponseIsRetried) {
+  ValveHarness h;
+  h.setup();
+  ASSERT_TRUE(h.run_until_established());
+  h.run_for(1000);
+  PollRequests normal = poll_counted(h);
+  ASSERT_EQ(normal.read_multiples, 1u);
+
+  h.valve.fail_next = 1;
+  h.valve.fail_status = ESP_GATT_BUSY;
+  h.valve.room_temperature = 18.0f;
+  PollRequests failed = poll_counted(h);
+  EXPECT_EQ(failed.read_multiples, normal.read_multiples + 1);
+  EXPECT_EQ(failed.reads, normal.reads);
+  EXPECT_FLOAT_EQ(h.temperature.state, 18.0f);
+
+  // Still batching
+  PollRequests next = poll_counted(h);
+  EXPECT_EQ(next.read_multiples, normal.read_multiples);
+  EXPECT_EQ(next.reads, normal.reads);
+}
+
+TEST(ReadMultipleTest, StackRejectionIsRetried) {
+  ValveHarness h;
+  h.setup();
+  ASSERT_TRUE(h.run_until_established());
+  h.run_for(1000);
+  PollRequests normal = poll_counted(h);
+
+  // Rejected requests never reach the valve, the retry is the only one it sees
+  h.valve.reject_next = 1;
+  h.valve.room_temperature = 18.5f;
+  PollRequests rejected = poll_counted(h);
+  EXPECT_EQ(rejected.read_multiples, normal.read_multiples);
+  EXPECT_EQ(rejected.reads, normal.reads);
+  EXPECT_FLOAT_EQ(h.temperature.state, 18.5f);
+
+  PollRequests next = poll_counted(h);
+  EXPECT_EQ(next.read_multiples, normal.read_multiples);
+}
+
+TEST(ReadMultipleTest, InvalidHandleDropsCachedHandlesAndKeepsBatching) {
+  ValveHarness h;
+  h.setup();
+  ASSERT_TRUE(h.run_until_established());
+  h.run_for(1000);
+
+  // Handles moved under the established link (no Service Changed indication), the cached ones are rejected
+  h.valve.set_handle_base(0x40);
+  uint32_t invalid_handles = h.valve.invalid_handles;
+  poll(h);
+  EXPECT_GT(h.valve.invalid_handles, invalid_handles);
+
+  // Cache dropped: the next session waits for discovery instead of using the stale handles
+  h.valve.config().discovery_ms = 60000;
+  h.drop_link();
+  ASSERT_TRUE(h.run_until([&]() { return h.valve.connected(); }, 5000));
+  uint32_t requests = h.valve.reads + h.valve.read_multiples + h.valve.writes;
+  poll(h);
+  EXPECT_EQ(h.valve.reads + h.valve.read_multiples + h.valve.writes, requests);
+
+  // Once discovered, the refresh is batched again
+  h.valve.config().discovery_ms = 600;
+  h.drop_link();
+  ASSERT_TRUE(h.run_until_established());
+  uint32_t read_multiples = h.valve.read_multiples;
+  poll(h);
+  EXPECT_GT(h.valve.read_multiples, read_multiples);
+  EXPECT_TRUE(h.temperature.has_state());
+}
+
+}  // namespace sim
+}  // namespace danfoss_eco
+}  // namespace esphome
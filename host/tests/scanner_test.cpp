@@ -0,0 +1,68 @@
+// Scanner listener against the busy-air advertisement corpus
+
+#include <gtest/gtest.h>
+#include <set>
+#include "esphome/components/danfoss_eco_scanner/device_scanner.h"
+#include "adv_corpus.h"
+#include "host_support.h"
+#include "scanner_baseline.h"
+
+namespace esphome {
+namespace danfoss_eco {
+namespace sim {
+
+static const uint32_t DANFOSS_OUI = 0x00042F;
+
+TEST(ScannerTest, AcceptsTheSameAdvertisementsAsTheBaselineFilter) {
+  auto corpus = load_busy_air_corpus();
+  ASSERT_FALSE(corpus.empty());
+  host::set_millis(100000);
+  danfoss_eco_scanner::DanfossEcoScanner scanner;
+
+  std::set<uint64_t> valves;
+  size_t accepted = 0;
+  for (auto &device : corpus) {
+    bool expected = reference::baseline_is_etrv(device);
+    EXPECT_EQ(scanner.parse_device(device), expected) << device.address_str() << " " << device.get_name();
+    if (expected) {
+      accepted++;
+      valves.insert(device.address_uint64());
+    }
+  }
+  EXPECT_GT(accepted, 0u);
+  EXPECT_EQ(valves.size(), 6u);
+  for (uint64_t address : valves)
+    EXPECT_NE(scanner.find(address), nullptr);
+}
+
+TEST(ScannerTest, OtherDanfossDevicesAreNotCached) {
+  auto corpus = load_busy_air_corpus();
+  host::set_millis(100000);
+  danfoss_eco_scanner::DanfossEcoScanner scanner;
+  size_t others = 0;
+  for (auto &device : corpus) {
+    scanner.parse_device(device);
+    if ((device.address_uint64() >> 24) == DANFOSS_OUI && !reference::baseline_is_etrv(device)) others++;
+  }
+  EXPECT_GT(others, 0u);
+  for (auto &device : corpus) {
+    if (!reference::baseline_is_etrv(device)) EXPECT_EQ(scanner.find(device.address_uint64()), nullptr);
+  }
+}
+
+// The flags character in front of the name says whether the secret key can be read
+TEST(ScannerTest, TracksSecretReadableFlag) {
+  host::set_millis(100000);
+  danfoss_eco_scanner::DanfossEcoScanner scanner;
+  uint64_t address = 0x00042F0000AAULL;
+  ASSERT_TRUE(scanner.parse_device(esp32_ble_tracker::ESPBTDevice(address, "0;00042f0000aa;eTRV", -70)));
+  EXPECT_FALSE(scanner.find(address)->secret_readable());
+  ASSERT_TRUE(scanner.parse_device(esp32_ble_tracker::ESPBTDevice(address, "4;00042f0000aa;eTRV", -70)));
+  EXPECT_TRUE(scanner.find(address)->secret_readable());
+  // Same name, address outside the Danfoss OUI
+  EXPECT_FALSE(scanner.parse_device(esp32_ble_tracker::ESPBTDevice(0x11042F0000AAULL, "4;00042f0000aa;eTRV", -70)));
+}
+
+}  // namespace sim
+}  // namespace danfoss_eco
+}  // namespace esphome
@@ -0,0 +1,49 @@
+#include <gtest/gtest.h>
+#include "esphome/components/danfoss_eco/command.h"
+#include "host_support.h"
+#include "valve_harness.h"
+
+namespace esphome {
+namespace danfoss_eco {
+namespace sim {
+
+TEST(ScheduleTest, ChunksHoldTheirDaysOnly) {
+  Xxtea xxtea;
+  EXPECT_EQ(ScheduleData(0, &xxtea).day_count(), 3);
+  EXPECT_EQ(ScheduleData(1, &xxtea).day_count(), 3);
+  EXPECT_EQ(ScheduleData(2, &xxtea).day_count(), 1);
+
+  // Past the last chunk: no days, so nothing is ever merged into the value
+  ScheduleData data(SCHEDULE_CHUNKS + 2, &xxtea);
+  EXPECT_EQ(data.chunk, SCHEDULE_CHUNKS);
+  EXPECT_EQ(data.day_count(), 0);
+  data.pending_mask = 0xff;
+  EXPECT_TRUE(data.has_changes());
+  data.commit();
+  for (uint8_t b : data.image) EXPECT_EQ(b, 0);
+}
+
+TEST(ScheduleTest, FailedWriteIsRetriedAfterReadBack) {
+  ValveHarness h;
+  h.setup();
+  ASSERT_TRUE(h.run_until_established());
+  h.run_for(2000);
+
+  // Thursday is the first day of the second chunk; every attempt of the first write fails
+  ScheduleDay day;
+  day.periods[0] = {12, 36};
+  h.valve.fail_next = COMMAND_MAX_ATTEMPTS;
+  h.valve.fail_status = ESP_GATT_WRITE_NOT_PERMIT;
+  uint32_t writes = h.valve.writes;
+  uint32_t reads = h.valve.reads;
+  h.component.set_schedule_day(3, day);
+
+  // Read back and written again well before the daily schedule refresh
+  ASSERT_TRUE(h.run_until([&]() { return h.valve.schedule[1][0] == 12 && h.valve.schedule[1][1] == 36; }, 10000));
+  EXPECT_EQ(h.valve.writes - writes, COMMAND_MAX_ATTEMPTS + 1u);
+  EXPECT_GE(h.valve.reads - reads, 1u);
+}
+
+}  // namespace sim
+}  // namespace danfoss_eco
+}  // namespace esphome
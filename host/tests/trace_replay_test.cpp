@@ -0,0 +1,99 @@
+// GATT traces captured against the simulated valve and replayed through a fresh component
+
+#include <gtest/gtest.h>
+#include <fstream>
+#include <sstream>
+#include "esphome/core/log.h"
+#include "host_support.h"
+#include "trace_replay.h"
+#include "valve_harness.h"
+
+namespace esphome {
+namespace danfoss_eco {
+namespace sim {
+
+// A session with polling, a setpoint change and a dropped link, dumped like danfoss_eco.dump_gatt_trace
+static std::string capture_trace() {
+  std::string log;
+  {
+    ValveHarness h;
+    h.setup([](MyComponent &c) { c.set_gatt_trace(512); });
+    h.run_until_established();
+    h.run_for(5 * 60 * 1000);
+    h.component.make_call().set_target_temperature(23.0f).perform();
+    h.run_for(60 * 1000);
+    h.drop_link();
+    h.run_for(5 * 60 * 1000);
+
+    int level = host_log_level;
+    host::set_log_level(ESPHOME_LOG_LEVEL_INFO);
+    host::set_log_capture(&log);
+    h.component.dump_gatt_trace();
+    host::set_log_capture(nullptr);
+    host::set_log_level(level);
+  }
+  return log;
+}
+
+TEST(TraceReplayTest, ParsesDumpedLogLines) {
+  GattTraceRecord rec;
+  ASSERT_TRUE(parse_trace_line(
+      "[12:00:01][I][danfoss_eco.trace:71]: TRACE 3 a08601001c000800030011223344556677880000000000000000000000000000",
+      &rec));
+  EXPECT_EQ(rec.timestamp, 100000u);
+  EXPECT_EQ(rec.handle, 0x1c);
+  EXPECT_EQ(rec.value_len, 8);
+  EXPECT_EQ(rec.event, ESP_GATTC_READ_CHAR_EVT);
+  EXPECT_EQ(rec.status, ESP_GATT_OK);
+  EXPECT_EQ(rec.payload[0], 0x11);
+  EXPECT_FALSE(parse_trace_line("[I][danfoss_eco.trace:62]: GATT trace: 3 of 3 events, oldest first", &rec));
+  EXPECT_FALSE(parse_trace_line("TRACE 3 a086", &rec));
+}
+
+TEST(TraceReplayTest, CapturedSessionReplaysWithoutDivergence) {
+  std::istringstream in(capture_trace());
+  auto records = load_trace(in);
+  ASSERT_GT(records.size(), 20u);
+
+  ReplayReport report = replay_trace(records);
+  EXPECT_FALSE(report.diverged) << report.divergence;
+  EXPECT_EQ(report.replayed + report.writes_skipped, report.records - report.skipped);
+  EXPECT_EQ(report.writes_skipped, 1u);
+  EXPECT_GT(report.decodes, 10u);
+}
+
+TEST(TraceReplayTest, ReportsFirstDivergence) {
+  std::istringstream in(capture_trace());
+  auto records = load_trace(in);
+  ReplayReport clean = replay_trace(records);
+  ASSERT_FALSE(clean.diverged);
+
+  // A single read answered for another handle than the component asked for
+  size_t changed = records.size();
+  for (size_t i = clean.skipped + records.size() / 2; i < records.size(); i++) {
+    if (records[i].event == ESP_GATTC_READ_CHAR_EVT) {
+      records[i].handle += 3;
+      changed = i;
+      break;
+    }
+  }
+  ASSERT_LT(changed, records.size());
+  ReplayReport report = replay_trace(records);
+  EXPECT_TRUE(report.diverged);
+  EXPECT_EQ(report.diverged_at, changed);
+  EXPECT_EQ(report.replayed + report.writes_skipped, changed - report.skipped);
+}
+
+// The trace committed next to the tool, as danfoss_eco_trace_replay would read it
+TEST(TraceReplayTest, SampleTraceReplays) {
+  std::ifstream in(DANFOSS_ECO_HOST_DATA_DIR "/sample_trace.log");
+  auto records = load_trace(in);
+  ASSERT_FALSE(records.empty());
+  ReplayReport report = replay_trace(records);
+  EXPECT_FALSE(report.diverged) << report.divergence;
+  EXPECT_GT(report.decodes, 0u);
+}
+
+}  // namespace sim
+}  // namespace danfoss_eco
+}  // namespace esphome
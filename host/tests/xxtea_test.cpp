@@ -0,0 +1,163 @@
+// Known answers for the XXTEA block kernels and a differential check against the baseline implementation
+
+#include <gtest/gtest.h>
+#include <array>
+#include <cstring>
+#include <random>
+#include <vector>
+#include "esphome/components/danfoss_eco/xxtea.h"
+#include "xxtea_baseline.h"
+
+namespace {
+
+uint8_t ZERO_KEY[16] = {0};
+uint8_t KEY[16] = {0x00, 0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77, 0x88, 0x99, 0xaa, 0xbb, 0xcc, 0xdd, 0xee, 0xff};
+
+struct KnownAnswer {
+  uint8_t *key;
+  bool counting;  // plaintext byte i is i * 7 + 1, otherwise all zero
+  size_t len;
+  uint8_t cipher[20];
+};
+
+// Produced by the baseline implementation (host/reference/xxtea_baseline.cpp)
+const KnownAnswer KNOWN_ANSWERS[] = {
+    {ZERO_KEY, false, 8, {0xab, 0x04, 0x37, 0x05, 0x80, 0x8c, 0x5d, 0x57}},
+    {ZERO_KEY, false, 16, {0xff, 0xd5, 0xc8, 0xe6, 0xe4, 0xb6, 0x0f, 0x07, 0xf7, 0x34, 0xa5, 0x98, 0x99, 0xe3, 0x03, 0xac}},
+    {ZERO_KEY,
+     false,
+     20,
+     {0x17, 0x26, 0xc7, 0x9a, 0x4d, 0x55, 0xf9, 0x58, 0x56, 0x40,
+      0xc6, 0x21, 0xe9, 0x4a, 0xa3, 0x0a, 0x3b, 0x8e, 0xdc, 0x5d}},
+    {KEY, true, 8, {0x35, 0xab, 0xb2, 0xe7, 0x43, 0xcb, 0xc0, 0x91}},
+    {KEY, true, 16, {0xb6, 0xf4, 0x54, 0x39, 0xb1, 0x3e, 0xa5, 0x8b, 0xce, 0x20, 0xf1, 0x5e, 0x5c, 0x1e, 0xfb, 0x48}},
+    {KEY,
+     true,
+     20,
+     {0x32, 0x4f, 0x7d, 0xce, 0x9f, 0xf5, 0xe1, 0x47, 0x45, 0x53,
+      0xfe, 0x44, 0xbd, 0xda, 0xd5, 0x75, 0x9c, 0x38, 0x58, 0x0d}},
+};
+
+void plaintext(const KnownAnswer &ka, uint8_t *out) {
+  for (size_t i = 0; i < ka.len; i++)
+    out[i] = ka.counting ? i * 7 + 1 : 0;
+}
+
+TEST(XxteaTest, EncryptMatchesKnownAnswers) {
+  for (const auto &ka : KNOWN_ANSWERS) {
+    Xxtea xxtea;
+    ASSERT_EQ(xxtea.set_key(ka.key, 16), XXTEA_STATUS_SUCCESS);
+    uint8_t plain[20], cipher[MAX_XXTEA_DATA8];
+    plaintext(ka, plain);
+    ASSERT_EQ(xxtea.encrypt(plain, ka.len, cipher), XXTEA_STATUS_SUCCESS);
+    EXPECT_EQ(std::memcmp(cipher, ka.cipher, ka.len), 0) << "len " << ka.len;
+  }
+}
+
+TEST(XxteaTest, DecryptMatchesKnownAnswers) {
+  for (const auto &ka : KNOWN_ANSWERS) {
+    Xxtea xxtea;
+    ASSERT_EQ(xxtea.set_key(ka.key, 16), XXTEA_STATUS_SUCCESS);
+    uint8_t expected[20], data[20];
+    plaintext(ka, expected);
+    std::memcpy(data, ka.cipher, ka.len);
+    ASSERT_EQ(xxtea.decrypt(data, ka.len), XXTEA_STATUS_SUCCESS);
+    EXPECT_EQ(std::memcmp(data, expected, ka.len), 0) << "len " << ka.len;
+  }
+}
+
+// The kernels work on the words in place, the same as the baseline btea() (negative n decrypts)
+template <int N> void expect_kernels_match_baseline(std::mt19937 &rng) {
+  for (int run = 0; run < 1000; run++) {
+    uint32_t k[4], v[N], expected[N];
+    for (auto &w : k)
+      w = rng();
+    for (int i = 0; i < N; i++)
+      v[i] = expected[i] = rng();
+
+    Xxtea::encrypt_block<N>(v, k);
+    XxteaBaseline::btea(expected, N, k);
+    ASSERT_EQ(std::memcmp(v, expected, sizeof(v)), 0) << "encrypt_block<" << N << "> run " << run;
+
+    Xxtea::decrypt_block<N>(v, k);
+    XxteaBaseline::btea(expected, -N, k);
+    ASSERT_EQ(std::memcmp(v, expected, sizeof(v)), 0) << "decrypt_block<" << N << "> run " << run;
+  }
+}
+
+TEST(XxteaTest, BlockKernelsMatchBaseline) {
+  std::mt19937 rng(1);
+  expect_kernels_match_baseline<2>(rng);
+  expect_kernels_match_baseline<4>(rng);
+}
+
+// Byte-level API, including the 20-byte schedule payloads that still go through the generic loop
+TEST(XxteaTest, EncryptDecryptMatchBaseline) {
+  std::mt19937 rng(2);
+  for (size_t len : {8, 16, 20}) {
+    for (int run = 0; run < 200; run++) {
+      uint8_t key[16], plain[20], cipher[MAX_XXTEA_DATA8], expected[MAX_XXTEA_DATA8];
+      for (auto &b : key)
+        b = rng();
+      for (auto &b : plain)
+        b = rng();
+      Xxtea xxtea;
+      XxteaBaseline baseline;
+      xxtea.set_key(key, sizeof(key));
+      baseline.set_key(key, sizeof(key));
+
+      ASSERT_EQ(xxtea.encrypt(plain, len, cipher), XXTEA_STATUS_SUCCESS);
+      ASSERT_EQ(baseline.encrypt(plain, len, expected), XXTEA_STATUS_SUCCESS);
+      ASSERT_EQ(std::memcmp(cipher, expected, len), 0) << "encrypt len " << len << " run " << run;
+
+      ASSERT_EQ(xxtea.decrypt(cipher, len), XXTEA_STATUS_SUCCESS);
+      ASSERT_EQ(baseline.decrypt(expected, len), XXTEA_STATUS_SUCCESS);
+      ASSERT_EQ(std::memcmp(cipher, expected, len), 0) << "decrypt len " << len << " run " << run;
+      ASSERT_EQ(std::memcmp(cipher, plain, len), 0) << "round trip len " << len << " run " << run;
+    }
+  }
+}
+
+// Each lane of decrypt_lanes() decrypts like its own Xxtea::decrypt() call with that lane's key
+TEST(XxteaTest, DecryptLanesMatchesScalarDecrypt) {
+  std::mt19937 rng(3);
+  for (size_t words : {2, 4}) {
+    for (size_t lanes : {1, 3, 8, 33}) {
+      std::vector<uint32_t> v(words * lanes), k(4 * lanes);
+      std::vector<std::array<uint8_t, 16>> expected(lanes);
+      for (size_t i = 0; i < lanes; i++) {
+        uint8_t key[16], cipher[16];
+        for (auto &b : key)
+          b = rng();
+        for (auto &b : cipher)
+          b = rng();
+        Xxtea xxtea;
+        xxtea.set_key(key, sizeof(key));
+        for (size_t j = 0; j < 4; j++)
+          k[j * lanes + i] = xxtea.key_words()[j];
+        for (size_t w = 0; w < words; w++)
+          std::memcpy(&v[w * lanes + i], cipher + w * 4, 4);
+        xxtea.decrypt(cipher, words * 4, expected[i].data());
+      }
+
+      ASSERT_EQ(Xxtea::decrypt_lanes(v.data(), k.data(), words, lanes), XXTEA_STATUS_SUCCESS);
+      for (size_t i = 0; i < lanes; i++) {
+        for (size_t w = 0; w < words; w++)
+          EXPECT_EQ(std::memcmp(&v[w * lanes + i], expected[i].data() + w * 4, 4), 0)
+              << words << " words, lane " << i << " of " << lanes;
+      }
+    }
+  }
+  uint32_t v[6] = {0}, k[4] = {0};
+  EXPECT_EQ(Xxtea::decrypt_lanes(v, k, 3, 1), XXTEA_STATUS_SIZE_ERROR);
+}
+
+TEST(XxteaTest, RejectsBadSizes) {
+  Xxtea xxtea;
+  uint8_t data[MAX_XXTEA_DATA8 + 4] = {0};
+  ASSERT_EQ(xxtea.set_key(KEY, 16), XXTEA_STATUS_SUCCESS);
+  EXPECT_EQ(xxtea.decrypt(data, 6), XXTEA_STATUS_PARAMETER_ERROR);
+  EXPECT_EQ(xxtea.decrypt(data, MAX_XXTEA_DATA8 + 4), XXTEA_STATUS_SIZE_ERROR);
+}
+
+}  // namespace
@@ -0,0 +1,241 @@
+#include "trace_replay.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include "esphome/core/hal.h"
+#include "esphome/components/danfoss_eco/helpers.h"
+#include "host_support.h"
+#include "valve_harness.h"
+
+namespace esphome {
+namespace danfoss_eco {
+namespace sim {
+
+static const size_t RECORD_HEX_LENGTH = sizeof(GattTraceRecord) * 2;
+
+static bool is_hex(char c) { return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F'); }
+
+bool parse_trace_line(const std::string &line, GattTraceRecord *record) {
+  size_t pos = line.find("TRACE ");
+  if (pos == std::string::npos) return false;
+  pos += 6;
+  size_t digits = pos;
+  while (pos < line.size() && line[pos] >= '0' && line[pos] <= '9') pos++;
+  if (pos == digits || pos >= line.size() || line[pos] != ' ') return false;
+  pos++;
+  if (line.size() - pos < RECORD_HEX_LENGTH) return false;
+  for (size_t i = 0; i < RECORD_HEX_LENGTH; i++) {
+    if (!is_hex(line[pos + i])) return false;
+  }
+  if (pos + RECORD_HEX_LENGTH < line.size() && is_hex(line[pos + RECORD_HEX_LENGTH])) return false;
+  // Records are dumped as their bytes, little-endian like the host
+  parse_hex_str(line.c_str() + pos, RECORD_HEX_LENGTH, reinterpret_cast<uint8_t *>(record));
+  return true;
+}
+
+std::vector<GattTraceRecord> load_trace(std::istream &in) {
+  std::vector<GattTraceRecord> records;
+  std::string line;
+  GattTraceRecord record;
+  while (std::getline(in, line)) {
+    if (parse_trace_line(line, &record)) records.push_back(record);
+  }
+  return records;
+}
+
+namespace {
+
+enum class RequestKind : uint8_t { NONE, READ, READ_MULTIPLE, WRITE };
+
+const char *kind_name(RequestKind kind) {
+  switch (kind) {
+    case RequestKind::READ:
+      return "read";
+    case RequestKind::READ_MULTIPLE:
+      return "Read Multiple";
+    case RequestKind::WRITE:
+      return "write";
+    default:
+      return "nothing";
+  }
+}
+
+// Accepts the component's requests while the traced link is up, answers come from the trace
+class RecordingServer : public host::GattServer {
+ public:
+  esp_err_t read_char(uint16_t handle) override { return this->send_(RequestKind::READ, handle); }
+  esp_err_t read_multiple(const esp_gattc_multi_t &multi) override {
+    return this->send_(RequestKind::READ_MULTIPLE, multi.num_attr > 0 ? multi.handles[0] : 0);
+  }
+  esp_err_t write_char(uint16_t handle, const uint8_t *value, uint16_t value_len) override {
+    return this->send_(RequestKind::WRITE, handle);
+  }
+
+  bool connected{false};
+  RequestKind outstanding{RequestKind::NONE};
+  uint16_t outstanding_handle{0};
+
+ protected:
+  esp_err_t send_(RequestKind kind, uint16_t handle) {
+    if (!this->connected) return ESP_FAIL;
+    this->outstanding = kind;
+    this->outstanding_handle = handle;
+    return ESP_OK;
+  }
+};
+
+RequestKind response_kind(uint8_t event) {
+  switch (event) {
+    case ESP_GATTC_READ_CHAR_EVT:
+      return RequestKind::READ;
+    case ESP_GATTC_READ_MULTIPLE_EVT:
+      return RequestKind::READ_MULTIPLE;
+    case ESP_GATTC_WRITE_CHAR_EVT:
+      return RequestKind::WRITE;
+    default:
+      return RequestKind::NONE;
+  }
+}
+
+}  // namespace
+
+ReplayReport replay_trace(const std::vector<GattTraceRecord> &records, const ReplayOptions &options) {
+  ReplayReport report;
+  report.records = records.size();
+  size_t first = 0;
+  while (first < records.size() && records[first].event != ESP_GATTC_OPEN_EVT) first++;
+  report.skipped = first;
+  if (first == records.size()) return report;
+
+  auto started = std::chrono::steady_clock::now();
+  ValveHarness h;
+  RecordingServer server;
+  host::set_gatt_server(&server);
+  h.valve.set_handle_base(options.handle_base);
+  // The component starts just before the first session, its clock follows the trace
+  host::set_millis(records[first].timestamp - 1);
+  h.setup([&](MyComponent &c) {
+    if (!options.secret_key.empty()) c.set_secret_key(options.secret_key);
+  });
+
+  uint8_t value[GattTraceRecord::TRACE_PAYLOAD_SIZE];
+  for (size_t i = first; i < records.size(); i++) {
+    const GattTraceRecord &rec = records[i];
+    while ((int32_t) (millis() - rec.timestamp) < 0) {
+      h.component.loop();
+      host::advance_millis(1);
+    }
+
+    RequestKind kind = response_kind(rec.event);
+    if (kind == RequestKind::WRITE && server.outstanding != RequestKind::WRITE) {
+      report.writes_skipped++;
+      continue;
+    }
+    if (kind != RequestKind::NONE) {
+      // Read Multiple responses carry no handle, only the kind is compared
+      bool handle_matches = kind == RequestKind::READ_MULTIPLE || rec.handle == server.outstanding_handle;
+      if (server.outstanding != kind || !handle_matches) {
+        report.diverged = true;
+        report.diverged_at = i;
+        char buf[160];
+        snprintf(buf, sizeof(buf), "trace has a %s response for handle 0x%04x at %u ms, component sent %s",
+                 kind_name(kind), rec.handle, rec.timestamp, kind_name(server.outstanding));
+        report.divergence = buf;
+        if (server.outstanding != RequestKind::NONE) {
+          snprintf(buf, sizeof(buf), " (handle 0x%04x)", server.outstanding_handle);
+          report.divergence += buf;
+        }
+        break;
+      }
+      server.outstanding = RequestKind::NONE;
+      report.responses++;
+      if (kind != RequestKind::WRITE && rec.status == ESP_GATT_OK) report.decodes++;
+    }
+
+    esp_ble_gattc_cb_param_t param{};
+    switch (rec.event) {
+      case ESP_GATTC_OPEN_EVT:
+        h.client.set_state(esp32_ble_tracker::ClientState::CONNECTING);
+        server.connected = rec.status == ESP_GATT_OK;
+        server.outstanding = RequestKind::NONE;
+        param.open.status = (esp_gatt_status_t) rec.status;
+        param.open.mtu = rec.handle;
+        memcpy(param.open.remote_bda, h.client.get_remote_bda(), sizeof(esp_bd_addr_t));
+        break;
+      case ESP_GATTC_CFG_MTU_EVT:
+        param.cfg_mtu.status = (esp_gatt_status_t) rec.status;
+        param.cfg_mtu.mtu = rec.handle;
+        break;
+      case ESP_GATTC_SEARCH_CMPL_EVT:
+        h.valve.populate(&h.client);
+        param.search_cmpl.status = (esp_gatt_status_t) rec.status;
+        break;
+      case ESP_GATTC_DISCONNECT_EVT:
+        server.connected = false;
+        server.outstanding = RequestKind::NONE;
+        param.disconnect.reason = rec.handle;
+        memcpy(param.disconnect.remote_bda, h.client.get_remote_bda(), sizeof(esp_bd_addr_t));
+        break;
+      case ESP_GATTC_WRITE_CHAR_EVT:
+        param.write.status = (esp_gatt_status_t) rec.status;
+        param.write.handle = rec.handle;
+        break;
+      case ESP_GATTC_READ_CHAR_EVT:
+      case ESP_GATTC_READ_MULTIPLE_EVT: {
+        // Values longer than the payload were cut when traced
+        uint16_t len = std::min<uint16_t>(rec.value_len, GattTraceRecord::TRACE_PAYLOAD_SIZE);
+        memcpy(value, rec.payload, len);
+        param.read.status = (esp_gatt_status_t) rec.status;
+        param.read.handle = rec.handle;
+        param.read.value = len > 0 ? value : nullptr;
+        param.read.value_len = len;
+        break;
+      }
+      default:
+        break;
+    }
+    h.client.gattc_event_handler((esp_gattc_cb_event_t) rec.event, h.client.get_gattc_if(), &param);
+    h.component.loop();
+    report.replayed++;
+    report.span_ms = rec.timestamp - records[first].timestamp;
+  }
+
+  host::set_gatt_server(nullptr);
+  report.wall_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+  return report;
+}
+
+std::string format_report(const ReplayReport &report) {
+  char buf[256];
+  std::string out;
+  snprintf(buf, sizeof(buf), "records: %u (%u skipped before the first connection)\n", report.records,
+           report.skipped);
+  out += buf;
+  snprintf(buf, sizeof(buf), "replayed: %u records, %u responses, %u decodes, %.1f s of trace in %.3f s\n",
+           report.replayed, report.responses, report.decodes, report.span_ms / 1000.0, report.wall_s);
+  out += buf;
+  if (report.writes_skipped > 0) {
+    snprintf(buf, sizeof(buf), "skipped: %u user writes\n", report.writes_skipped);
+    out += buf;
+  }
+  if (report.wall_s > 0) {
+    snprintf(buf, sizeof(buf), "throughput: %.0f events/s, %.0f decodes/s, %.0fx real time\n",
+             report.replayed / report.wall_s, report.decodes / report.wall_s,
+             report.span_ms / 1000.0 / report.wall_s);
+    out += buf;
+  }
+  if (report.diverged) {
+    snprintf(buf, sizeof(buf), "diverged at record %u: ", report.diverged_at);
+    out += buf;
+    out += report.divergence;
+    out += '\n';
+  } else {
+    out += "no divergence\n";
+  }
+  return out;
+}
+
+}  // namespace sim
+}  // namespace danfoss_eco
+}  // namespace esphome
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstdint>
+#include <istream>
+#include <string>
+#include <vector>
+#include "esphome/components/danfoss_eco/gatt_trace.h"
+
+namespace esphome {
+namespace danfoss_eco {
+namespace sim {
+
+/**
+ * Records of a GATT trace dump ("TRACE <index> <64 hex digits>" lines, see GattTrace::dump()),
+ * oldest first. Anything else on the line (log prefix) and lines without a record are ignored.
+ */
+std::vector<GattTraceRecord> load_trace(std::istream &in);
+// One record from a log line, false if the line doesn't hold one
+bool parse_trace_line(const std::string &line, GattTraceRecord *record);
+
+struct ReplayOptions {
+  std::string secret_key;      // hex, as in the YAML; empty uses the simulated valve's key
+  uint16_t handle_base{0x10};  // characteristic handles as laid out by SimulatedValve
+};
+
+struct ReplayReport {
+  uint32_t records{0};
+  uint32_t skipped{0};    // records before the first ESP_GATTC_OPEN_EVT, state before it is unknown
+  uint32_t replayed{0};   // records handed to the component
+  uint32_t responses{0};  // read/write responses matched to a request of the component
+  uint32_t decodes{0};    // successful read responses among them
+  uint32_t writes_skipped{0};  // write responses the component had no write for (user input isn't traced)
+  uint32_t span_ms{0};    // trace time covered by the replayed records
+  double wall_s{0};       // host time taken by the replay
+
+  bool diverged{false};
+  uint32_t diverged_at{0};  // index of the first record which doesn't match what the component did
+  std::string divergence;
+};
+
+/**
+ * Replays a trace through MyComponent/Device on the simulated clock, as fast as the host runs it.
+ *
+ * The component is driven millisecond by millisecond between records, so it sends its requests on
+ * its own schedule. Each response record is checked against the request the component actually has
+ * outstanding; the first mismatch (other handle or kind, or no request at all) is reported and ends
+ * the replay, since the component's state no longer follows the valve after it. Writes come from user
+ * input, which the trace doesn't hold, so a write response the component has no write for is skipped.
+ * The component has to be configured like the one that captured the trace (default polling, same key
+ * and handle layout).
+ */
+ReplayReport replay_trace(const std::vector<GattTraceRecord> &records, const ReplayOptions &options = {});
+
+// Human readable summary of a report, several lines
+std::string format_report(const ReplayReport &report);
+
+}  // namespace sim
+}  // namespace danfoss_eco
+}  // namespace esphome
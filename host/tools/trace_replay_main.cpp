@@ -0,0 +1,51 @@
+// Replays a GATT trace dumped by danfoss_eco.dump_gatt_trace through the component on the host:
+//
+//   danfoss_eco_trace_replay [--key <secret key hex>] [--handle-base <n>] [log file]
+//
+// Reads the log from stdin without a file. Exits with 1 if the replay diverged from the trace.
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include "trace_replay.h"
+
+using namespace esphome::danfoss_eco::sim;
+
+int main(int argc, char **argv) {
+  ReplayOptions options;
+  const char *path = nullptr;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--key") == 0 && i + 1 < argc) {
+      options.secret_key = argv[++i];
+    } else if (strcmp(argv[i], "--handle-base") == 0 && i + 1 < argc) {
+      options.handle_base = (uint16_t) strtoul(argv[++i], nullptr, 0);
+    } else if (argv[i][0] != '-' && path == nullptr) {
+      path = argv[i];
+    } else {
+      fprintf(stderr, "usage: %s [--key <secret key hex>] [--handle-base <n>] [log file]\n", argv[0]);
+      return 2;
+    }
+  }
+
+  std::vector<esphome::danfoss_eco::GattTraceRecord> records;
+  if (path != nullptr) {
+    std::ifstream in(path);
+    if (!in) {
+      fprintf(stderr, "can't open %s\n", path);
+      return 2;
+    }
+    records = load_trace(in);
+  } else {
+    records = load_trace(std::cin);
+  }
+  if (records.empty()) {
+    fprintf(stderr, "no TRACE records found\n");
+    return 2;
+  }
+
+  ReplayReport report = replay_trace(records, options);
+  fputs(format_report(report).c_str(), stdout);
+  return report.diverged ? 1 : 0;
+}